@@ -17,13 +17,136 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// 0 - full terrain mesh, 1 - LOD patches displaced by the height map,
+// 2 - full detail patches displaced by the height map, 3 - full terrain
+// mesh with packed vertices
+uniform int renderMode;
+
+// Terrain grid layout
+uniform float gridSize;
+uniform float verticeOffset;
+uniform float startPos;
+
+// LOD/displacement - heights and biome colours for the whole map
+uniform sampler2D heightMap;
+uniform sampler2D biomeMap;
+
+// Maps height map/packed vertex values to terrain heights
+uniform float heightScale;
+uniform float heightMin;
+
+// LOD - current node and camera position (terrain space)
+uniform vec2 nodeOffset;	// First grid column/row of the node
+uniform float nodeScale;	// Grid vertices per patch quad
+uniform vec2 morphRange;	// Distances to start/finish morphing to the next level
+uniform vec3 lodCameraPos;
+
+// Packed mesh - vertices are stored in square chunks, in rows across the map
+uniform int drawChunks;		// Chunks along each side of the map
+uniform int drawChunkSize;	// Quads along each side of a chunk
+
+// Displacement - one patch is drawn per instance, in rows across the map
+uniform int patchSize;		// Quads along each side of a patch
+uniform int patchesPerSide;
+
+// Gets the terrain height at a grid position (column, row)
+float getHeight(vec2 gridPos)
+{
+	return texture(heightMap, (gridPos + 0.5f) / gridSize).r * heightScale + heightMin;
+}
+
+// Converts a grid position to terrain space - x increases with column,
+// z decreases with row
+vec3 getTerrainPos(vec2 gridPos)
+{
+	return vec3(startPos + gridPos.x * verticeOffset, getHeight(gridPos), startPos - gridPos.y * verticeOffset);
+}
+
+// Decodes an octahedral encoded normal (packed vertices)
+vec3 decodeNormal(vec2 encoded)
+{
+	vec3 n = vec3(encoded.x, 1.0f - abs(encoded.x) - abs(encoded.y), encoded.y);
+
+	// Unfold the lower half of the octahedron
+	if (n.y < 0.0f)
+	{
+		n.xz = (1.0f - abs(n.zx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.z >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return normalize(n);
+}
+
 void main()
 {
-	gl_Position = projection * view * model * vec4(position, 1.0);
+	vec3 terrainPos = position;
+	vec3 terrainNormal = normal;
+
+	// Grid position (column, row) of this vertex when drawing patches
+	vec2 gridPos = vec2(0.0f);
 
 	colourFrag = colour;
 	TexturesFrag = textureCoords;
 
-	FragPos = vec3(model * vec4(position, 1.0f));
-	Normal = mat3(transpose(inverse(model))) * normal;
-}
\ No newline at end of file
+	if (renderMode == 1)
+	{
+		// Patch vertex position (x/z) in patch quads
+		vec2 patchPos = position.xz;
+
+		gridPos = min(nodeOffset + patchPos * nodeScale, vec2(gridSize - 1.0f));
+
+		// Morph odd vertices onto the next level's grid as they get further
+		// from the camera, so there is no visible jump between levels
+		float dist = distance(lodCameraPos, getTerrainPos(gridPos));
+		float morph = clamp((dist - morphRange.x) / (morphRange.y - morphRange.x), 0.0f, 1.0f);
+
+		patchPos -= fract(patchPos * 0.5f) * 2.0f * morph;
+
+		gridPos = min(nodeOffset + patchPos * nodeScale, vec2(gridSize - 1.0f));
+	}
+	else if (renderMode == 2)
+	{
+		vec2 patchOffset = vec2(gl_InstanceID % patchesPerSide, gl_InstanceID / patchesPerSide) * patchSize;
+
+		// Patches past the edge of the map are flattened onto it
+		gridPos = min(patchOffset + position.xz, vec2(gridSize - 1.0f));
+	}
+	else if (renderMode == 3)
+	{
+		// Packed vertex - position.x holds the height, normal.xy the encoded
+		// normal. x/z and texture coordinates come from the vertex's grid position,
+		// worked out from its chunk and its place within the chunk. Vertices
+		// past the edge of the map repeat the last row/column.
+		int chunkSide = drawChunkSize + 1;
+		int chunk = gl_VertexID / (chunkSide * chunkSide);
+		int chunkVertex = gl_VertexID % (chunkSide * chunkSide);
+
+		gridPos = vec2(chunk % drawChunks, chunk / drawChunks) * drawChunkSize + vec2(chunkVertex % chunkSide, chunkVertex / chunkSide);
+		gridPos = min(gridPos, vec2(gridSize - 1.0f));
+
+		terrainPos = vec3(startPos + gridPos.x * verticeOffset, position.x * heightScale + heightMin, startPos - gridPos.y * verticeOffset);
+		terrainNormal = decodeNormal(normal.xy);
+
+		TexturesFrag = gridPos / gridSize;
+	}
+
+	if (renderMode == 1 || renderMode == 2)
+	{
+		terrainPos = getTerrainPos(gridPos);
+
+		// Normal from the height difference between neighbouring vertices
+		float left = getHeight(gridPos - vec2(1.0f, 0.0f));
+		float right = getHeight(gridPos + vec2(1.0f, 0.0f));
+		float up = getHeight(gridPos - vec2(0.0f, 1.0f));
+		float down = getHeight(gridPos + vec2(0.0f, 1.0f));
+
+		terrainNormal = normalize(vec3(left - right, 2.0f * verticeOffset, down - up));
+
+		colourFrag = texture(biomeMap, (gridPos + 0.5f) / gridSize);
+		TexturesFrag = gridPos / gridSize;
+	}
+
+	gl_Position = projection * view * model * vec4(terrainPos, 1.0);
+
+	FragPos = vec3(model * vec4(terrainPos, 1.0f));
+	Normal = mat3(transpose(inverse(model))) * terrainNormal;
+}
@@ -8,6 +8,8 @@
 
 #include "..\h\Buffers.h"
 
+#include <math.h>
+
 using namespace glm;
 
 VAO::VAO()
@@ -22,6 +24,12 @@ VAO::VAO()
 VAO::~VAO()
 {
 	unbind();
+
+	// Free the buffers owned by this VAO
+	delete verticesBuffer;
+	delete indicesBuffer;
+
+	glDeleteVertexArrays(1, &vaoId);
 }
 
 // Gets the size of each coordinate (x2, x3 etc.) for a given type of buffer.
@@ -65,9 +73,63 @@ void VAO::addBuffer(const void* pData, int size, BufferType type)
 	}	
 }
 
-// Enables requested vertex arrays from the following: BUF_VERTICES | BUF_NORMALS | BUF_TEXTURES | BUF_COLOURS
+// Overwrites part of the vertex buffer, e.g. after editing some vertices.
+// Offset and size are in bytes.
+void VAO::updateVertices(const void* pData, int offset, int size)
+{
+	if (verticesBuffer != NULL)
+	{
+		verticesBuffer->update(pData, offset, size);
+	}
+}
+
+// Replaces the whole index buffer, which may change size (e.g. after an
+// adaptive mesh is rebuilt). The VAO must be bound. Size is in bytes.
+void VAO::replaceIndices(const void* pData, int size)
+{
+	if (indicesBuffer != NULL)
+	{
+		indicesBuffer->replace(pData, size);
+	}
+}
+
+// Uses another VAO's index buffer instead of one of its own, so meshes with
+// the same index pattern share one copy. This VAO must be bound. The owner
+// keeps the buffer, so must outlive this VAO.
+void VAO::shareIndices(const VAO* owner)
+{
+	if (owner->indicesBuffer != NULL)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, owner->indicesBuffer->bufferId);
+	}
+}
+
+// Enables requested vertex arrays from the following: BUF_VERTICES | BUF_NORMALS | BUF_TEXTURES | BUF_COLOURS.
+// With BUF_PACKED the buffer holds PackedVertexData - the vertices array is the height only,
+// normals are the two octahedral components, and there are no texture coordinates.
 void VAO::enableAttribArrays(int data)
 {
+	if (data & BUF_PACKED)
+	{
+		if (data & BUF_VERTICES)
+		{
+			glVertexAttribPointer(VERTICES, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertexData), (void*)offsetof(PackedVertexData, height));
+			glEnableVertexAttribArray(VERTICES);
+		}
+		if (data & BUF_NORMALS)
+		{
+			glVertexAttribPointer(NORMALS, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertexData), (void*)offsetof(PackedVertexData, normals));
+			glEnableVertexAttribArray(NORMALS);
+		}
+		if (data & BUF_COLOURS)
+		{
+			glVertexAttribPointer(COLOURS, getCoordSize(COLOURS), GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertexData), (void*)offsetof(PackedVertexData, colours));
+			glEnableVertexAttribArray(COLOURS);
+		}
+
+		return;
+	}
+
 	if (data & BUF_VERTICES)
 	{
 		// Vertices
@@ -94,6 +156,37 @@ void VAO::enableAttribArrays(int data)
 	}
 }
 
+// Packs a vertex into the compact layout. Heights are stored relative to
+// heightMin, scaled by heightScale (the height range of the mesh).
+VAO::PackedVertexData VAO::packVertex(const VertexData& vertex, float heightMin, float heightScale)
+{
+	PackedVertexData packed;
+
+	// Octahedral encoding - project the normal onto an octahedron around the
+	// y axis and flatten it, folding the lower half over the upper half
+	vec3 n = vertex.normals / (fabs(vertex.normals.x) + fabs(vertex.normals.y) + fabs(vertex.normals.z));
+	vec2 encoded = vec2(n.x, n.z);
+
+	if (n.y < 0.0f)
+	{
+		encoded.x = (1.0f - fabs(n.z)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		encoded.y = (1.0f - fabs(n.x)) * (n.z >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	packed.normals[0] = (short)roundf(glm::clamp(encoded.x, -1.0f, 1.0f) * 32767.0f);
+	packed.normals[1] = (short)roundf(glm::clamp(encoded.y, -1.0f, 1.0f) * 32767.0f);
+
+	for (int c = 0; c < 4; c++)
+	{
+		packed.colours[c] = (unsigned char)(glm::clamp(vertex.colours[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	packed.height = (unsigned short)(glm::clamp((vertex.vertices.y - heightMin) / heightScale, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	packed.padding = 0;
+
+	return (packed);
+}
+
 void VAO::bind()
 {
 	// Bind VAO to current context.
@@ -121,6 +214,8 @@ VBO::VBO(const void* pData, int size)
 VBO::~VBO()
 {
 	unbind();
+
+	glDeleteBuffers(1, &bufferId);
 }
 
 void VBO::bind()
@@ -133,6 +228,16 @@ void VBO::unbind()
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+// Overwrites part of the buffer - offset and size are in bytes.
+void VBO::update(const void* pData, int offset, int size)
+{
+	bind();
+
+	glBufferSubData(GL_ARRAY_BUFFER, offset, size, pData);
+
+	unbind();
+}
+
 IBO::IBO(const void* pData, int size)
 {
 	glGenBuffers(1, &bufferId);
@@ -143,7 +248,18 @@ IBO::IBO(const void* pData, int size)
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, pData, GL_STATIC_DRAW);
 }
 
+// Reallocates the buffer with new contents - orphaning the old storage, so
+// draws still using it are not waited on.
+void IBO::replace(const void* pData, int size)
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferId);
+
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, pData, GL_STATIC_DRAW);
+}
+
 IBO::~IBO()
 {
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	glDeleteBuffers(1, &bufferId);
 }
\ No newline at end of file
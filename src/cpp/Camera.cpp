@@ -3,9 +3,10 @@
 Camera::Camera(Terrain* t)
 {
 	// Set user (camera) position to start of the terrain
-	// + VERTICE_OFFSET for x/z so not directly at the edge
+	// + vertice offset for x/z so not directly at the edge
 	// + USER_HEIGHT for y so the user is not crawling or clipping through the ground
-	camInfo.cameraPos	= vec3(TERRAIN_START.x + VERTICE_OFFSET, TERRAIN_START.y + USER_HEIGHT, TERRAIN_START.z + VERTICE_OFFSET);
+	float verticeOffset = t->getConfig().verticeOffset;
+	camInfo.cameraPos	= vec3(TERRAIN_START.x + verticeOffset, TERRAIN_START.y + USER_HEIGHT, TERRAIN_START.z + verticeOffset);
 	camInfo.cameraFront = vec3(0.0f, 0.0f, -1.0f);
 	camInfo.cameraUp	= vec3(0.0f, 1.0f, 0.0f);
 
@@ -144,6 +145,8 @@ void Camera::processUserInput(GLFWwindow* pW, float deltaTime)
 	static bool origKeyPress = false;
 	bool keyPress = false;
 
+	static bool regenKeyDown = false;
+
 	// Allows user to press escape to close the window
 	if (glfwGetKey(pW, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
@@ -169,6 +172,58 @@ void Camera::processUserInput(GLFWwindow* pW, float deltaTime)
 		toggleWalk();
 	}
 
+	// N - generate a new world (the next seed) in the background, once per press
+	if (glfwGetKey(pW, GLFW_KEY_N) == GLFW_PRESS)
+	{
+		if (!regenKeyDown)
+		{
+			terrain->regenerate(terrain->getConfig().worldSeed + 1);
+		}
+
+		regenKeyDown = true;
+	}
+	else
+	{
+		regenKeyDown = false;
+	}
+
+	// Terrain editing, at the ground in front of the camera - R/F raise/lower,
+	// T flattens, G/H paint grass/sand
+	if (length(actualFront) > 0.0f)
+	{
+		vec3 brushPos = actualPos + normalize(actualFront) * EDIT_DISTANCE;
+
+		if (glfwGetKey(pW, GLFW_KEY_R) == GLFW_PRESS)
+		{
+			terrain->editTerrain(Terrain::EDIT_RAISE, brushPos, EDIT_RADIUS, EDIT_SPEED * deltaTime);
+		}
+		if (glfwGetKey(pW, GLFW_KEY_F) == GLFW_PRESS)
+		{
+			terrain->editTerrain(Terrain::EDIT_LOWER, brushPos, EDIT_RADIUS, EDIT_SPEED * deltaTime);
+		}
+		if (glfwGetKey(pW, GLFW_KEY_T) == GLFW_PRESS)
+		{
+			terrain->editTerrain(Terrain::EDIT_FLATTEN, brushPos, EDIT_RADIUS, EDIT_SPEED * deltaTime);
+		}
+		if (glfwGetKey(pW, GLFW_KEY_G) == GLFW_PRESS)
+		{
+			terrain->editTerrain(Terrain::EDIT_PAINT, brushPos, EDIT_RADIUS, 1.0f, Terrain::GRASS);
+		}
+		if (glfwGetKey(pW, GLFW_KEY_H) == GLFW_PRESS)
+		{
+			terrain->editTerrain(Terrain::EDIT_PAINT, brushPos, EDIT_RADIUS, 1.0f, Terrain::DESERT);
+		}
+	}
+
+	// When walking, the ground height (in world space) and biome under the
+	// camera - the same for whichever way it moves
+	float groundHeight = 0.0f;
+
+	if (mode == WALK)
+	{
+		terrain->getGroundSamples(&actualPos.x, &actualPos.z, 1, &groundHeight, NULL, &biome);
+	}
+
 	// W - forward
 	if (glfwGetKey(pW, GLFW_KEY_W) == GLFW_PRESS)
 	{
@@ -177,9 +232,7 @@ void Camera::processUserInput(GLFWwindow* pW, float deltaTime)
 		{
 			keyPress = true;
 
-			biome = terrain->offsetUserPos(&actualPos);
-
-			proposedPos.y = TERRAIN_START.y + USER_HEIGHT + actualPos.y;
+			proposedPos.y = USER_HEIGHT + groundHeight;
 			proposedPos += moveSpeed * actualFront;
 
 			if (!terrain->isAtEdge(proposedPos))
@@ -201,9 +254,7 @@ void Camera::processUserInput(GLFWwindow* pW, float deltaTime)
 		{
 			keyPress = true;
 
-			biome = terrain->offsetUserPos(&actualPos);
-
-			proposedPos.y = TERRAIN_START.y + USER_HEIGHT + actualPos.y;
+			proposedPos.y = USER_HEIGHT + groundHeight;
 			proposedPos -= moveSpeed * actualFront;
 
 			if (!terrain->isAtEdge(proposedPos))
@@ -228,9 +279,7 @@ void Camera::processUserInput(GLFWwindow* pW, float deltaTime)
 		{
 			keyPress = true;
 
-			biome = terrain->offsetUserPos(&actualPos);
-
-			proposedPos.y = TERRAIN_START.y + USER_HEIGHT + actualPos.y;
+			proposedPos.y = USER_HEIGHT + groundHeight;
 			//camInfo.cameraPos += normalize(cross(camInfo.cameraFront, camInfo.cameraUp)) * moveSpeed;
 			proposedPos += normalize(cross(actualFront, camInfo.cameraUp)) * moveSpeed;
 
@@ -254,9 +303,7 @@ void Camera::processUserInput(GLFWwindow* pW, float deltaTime)
 		{
 			keyPress = true;
 
-			biome = terrain->offsetUserPos(&actualPos);
-
-			proposedPos.y = TERRAIN_START.y + USER_HEIGHT + actualPos.y;
+			proposedPos.y = USER_HEIGHT + groundHeight;
 			proposedPos -= normalize(cross(actualFront, camInfo.cameraUp)) * moveSpeed;
 
 			if (!terrain->isAtEdge(proposedPos))
@@ -370,7 +417,8 @@ void Camera::toggleWalk()
 	if (mode != WALK)
 	{
 		// Reset camera pos to start of terrain
-		camInfo.cameraPos = vec3(TERRAIN_START.x + VERTICE_OFFSET, TERRAIN_START.y + USER_HEIGHT, TERRAIN_START.z + VERTICE_OFFSET);
+		float verticeOffset = terrain->getConfig().verticeOffset;
+		camInfo.cameraPos = vec3(TERRAIN_START.x + verticeOffset, TERRAIN_START.y + USER_HEIGHT, TERRAIN_START.z + verticeOffset);
 	}
 
 	mode = WALK;
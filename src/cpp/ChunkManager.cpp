@@ -0,0 +1,385 @@
+#include "..\h\ChunkManager.h"
+#include "..\h\Terrain.h"
+#include "..\h\ThreadPool.h"
+#include "..\h\MeshOptimiser.h"
+
+#include <algorithm>
+#include <math.h>
+
+ChunkManager::ChunkManager(const TerrainConfig& cfg) : config(cfg), noise(cfg)
+{
+	tasksInFlight = 0;
+	stopping = false;
+
+	// Work out how many chunks fit in the memory budget - the indices are
+	// shared, so only the vertices count
+	int chunkBytes = CHUNK_VERTICES * CHUNK_VERTICES * sizeof(VAO::VertexData);
+
+	maxChunks = STREAM_MEMORY_BUDGET / chunkBytes;
+
+	generateIndices();
+
+	indexVAO = new VAO();
+	indexVAO->bind();
+	indexVAO->addBuffer(chunkIndices.data(), (int)(chunkIndices.size() * sizeof(GLushort)), VAO::INDICES);
+	indexVAO->unbind();
+}
+
+ChunkManager::~ChunkManager()
+{
+	// Wait for any chunks still being generated before freeing anything
+	{
+		unique_lock<mutex> lock(readyLock);
+		stopping = true;
+		tasksSignal.wait(lock, [this]() { return (tasksInFlight == 0); });
+	}
+
+	for (int i = 0; i < readyChunks.size(); i++)
+	{
+		delete readyChunks[i];
+	}
+
+	for (auto it = loadedChunks.begin(); it != loadedChunks.end(); it++)
+	{
+		delete it->second.vao;
+	}
+
+	// After the chunks using its index buffer
+	delete indexVAO;
+}
+
+// Returns the number of chunks currently on the GPU.
+int ChunkManager::getLoadedChunks()
+{
+	return ((int)loadedChunks.size());
+}
+
+// Samples the streamed ground at terrain space x/z positions - the height
+// interpolated across the square each lies in, the normal of that surface and
+// the walking biome of the closest vertex, as HeightField does for the fixed
+// map. Worked out from the noise the chunks are made from, so it matches them
+// whether or not they are loaded. Any of the outputs can be NULL.
+void ChunkManager::getSamples(const float* x, const float* z, int count, float* heights, vec3* normals, TerrainGenerator::Biome* biomes)
+{
+	float offset = config.verticeOffset;
+
+	for (int n = 0; n < count; n++)
+	{
+		// Same layout as the chunks - x increases along a row, z decreases
+		// with each row
+		float col = (x[n] - config.getStartPos()) / offset;
+		float row = (config.getStartPos() - z[n]) / offset;
+
+		float col0 = floorf(col);
+		float row0 = floorf(row);
+
+		float tx = col - col0;
+		float tz = row - row0;
+
+		float h00 = noise.getSample(row0, col0).height;
+		float h01 = noise.getSample(row0, col0 + 1.0f).height;
+		float h10 = noise.getSample(row0 + 1.0f, col0).height;
+		float h11 = noise.getSample(row0 + 1.0f, col0 + 1.0f).height;
+
+		if (heights != NULL)
+		{
+			heights[n] = mix(mix(h00, h01, tx), mix(h10, h11, tx), tz);
+		}
+
+		if (normals != NULL)
+		{
+			float slopeX = mix(h01 - h00, h11 - h10, tz);
+			float slopeZ = mix(h10 - h00, h11 - h01, tx);
+
+			normals[n] = normalize(vec3(-slopeX, offset, slopeZ));
+		}
+
+		if (biomes != NULL)
+		{
+			TerrainNoise::Sample s = noise.getSample(floorf(row + 0.5f), floorf(col + 0.5f));
+
+			biomes[n] = TerrainGenerator::biomeTable[TerrainGenerator::getBiome(s.terrain, s.path)].walkBiome;
+		}
+	}
+}
+
+// Generates the indices shared by every chunk - two triangles per square.
+// A chunk's vertices fit in 16 bit indices, and the triangles are reordered
+// for the vertex cache, as for the main terrain's chunk pattern.
+void ChunkManager::generateIndices()
+{
+	chunkIndices.reserve((CHUNK_VERTICES - 1) * (CHUNK_VERTICES - 1) * CHUNK_TRIANGLES * 3);
+
+	for (int row = 0; row < CHUNK_VERTICES - 1; row++)
+	{
+		for (int col = 0; col < CHUNK_VERTICES - 1; col++)
+		{
+			GLushort topLeft = (GLushort)(row * CHUNK_VERTICES + col);
+			GLushort bottomLeft = (GLushort)(topLeft + CHUNK_VERTICES);
+
+			chunkIndices.push_back(topLeft);
+			chunkIndices.push_back(topLeft + 1);
+			chunkIndices.push_back(bottomLeft);
+
+			chunkIndices.push_back(topLeft + 1);
+			chunkIndices.push_back(bottomLeft + 1);
+			chunkIndices.push_back(bottomLeft);
+		}
+	}
+
+	MeshOptimiser::optimiseVertexCache(chunkIndices.data(), (int)chunkIndices.size(), CHUNK_VERTICES * CHUNK_VERTICES);
+}
+
+// Generates the vertices for one chunk. Chunks share their edge vertices with
+// their neighbours, and use the same grid coordinates as the main terrain, so
+// the streamed world lines up with it. Runs on a worker thread - no GL calls.
+ChunkManager::ChunkData* ChunkManager::generateChunk(int chunkX, int chunkZ)
+{
+	ChunkData* data = new ChunkData();
+	data->chunkX = chunkX;
+	data->chunkZ = chunkZ;
+	data->vertices.resize(CHUNK_VERTICES * CHUNK_VERTICES);
+
+	int firstRow = chunkZ * (CHUNK_VERTICES - 1);
+	int firstCol = chunkX * (CHUNK_VERTICES - 1);
+
+	// Sample one extra vertex around the edge so normals can be
+	// calculated at the chunk borders
+	const int apronSize = CHUNK_VERTICES + 2;
+	vector<TerrainNoise::Sample> samples(apronSize * apronSize);
+
+	for (int row = 0; row < apronSize; row++)
+	{
+		for (int col = 0; col < apronSize; col++)
+		{
+			samples[row * apronSize + col] = noise.getSample((float)(firstRow + row - 1), (float)(firstCol + col - 1));
+		}
+	}
+
+	float offset = config.verticeOffset;
+
+	for (int row = 0; row < CHUNK_VERTICES; row++)
+	{
+		for (int col = 0; col < CHUNK_VERTICES; col++)
+		{
+			int a = (row + 1) * apronSize + (col + 1);
+			VAO::VertexData& v = data->vertices[row * CHUNK_VERTICES + col];
+
+			const TerrainNoise::Sample& s = samples[a];
+
+			// Same layout as the main terrain - x increases along a row,
+			// z decreases with each row
+			v.vertices.x = config.getStartPos() + (firstCol + col) * offset;
+			v.vertices.y = s.height;
+			v.vertices.z = config.getStartPos() - (firstRow + row) * offset;
+
+			v.colours = Terrain::getBiomeColour(Terrain::getBiome(s.terrain, s.path));
+
+			// Normal from the height difference between neighbouring vertices
+			float left	= samples[a - 1].height;
+			float right = samples[a + 1].height;
+			float up	= samples[a - apronSize].height;
+			float down	= samples[a + apronSize].height;
+
+			v.normals = normalize(vec3(left - right, 2.0f * offset, down - up));
+
+			// Textures repeat every gridSize vertices, as on the main terrain
+			v.textures.x = (float)(firstCol + col) / config.gridSize;
+			v.textures.y = (float)(firstRow + row) / config.gridSize;
+		}
+	}
+
+	return (data);
+}
+
+// Uploads a generated chunk to its own VAO.
+void ChunkManager::uploadChunk(ChunkData* data)
+{
+	Chunk chunk;
+	chunk.chunkX = data->chunkX;
+	chunk.chunkZ = data->chunkZ;
+
+	chunk.vao = new VAO();
+	chunk.vao->bind();
+
+	chunk.vao->addBuffer(data->vertices.data(), (int)(data->vertices.size() * sizeof(VAO::VertexData)), VAO::VERTICES);
+	chunk.vao->shareIndices(indexVAO);
+
+	chunk.vao->enableAttribArrays(BUF_VERTICES | BUF_COLOURS | BUF_NORMALS | BUF_TEXTURES);
+
+	chunk.vao->unbind();
+
+	loadedChunks[make_pair(data->chunkX, data->chunkZ)] = chunk;
+}
+
+// Queues a chunk to be generated on the thread pool.
+void ChunkManager::requestChunk(int chunkX, int chunkZ)
+{
+	pendingChunks.insert(make_pair(chunkX, chunkZ));
+
+	{
+		lock_guard<mutex> lock(readyLock);
+		tasksInFlight++;
+	}
+
+	ThreadPool::getShared()->submit([this, chunkX, chunkZ]()
+	{
+		ChunkData* data = NULL;
+
+		// Skip the work if the manager is shutting down
+		if (!stopping)
+		{
+			data = generateChunk(chunkX, chunkZ);
+		}
+
+		lock_guard<mutex> lock(readyLock);
+
+		if (data != NULL)
+		{
+			readyChunks.push_back(data);
+		}
+
+		tasksInFlight--;
+		tasksSignal.notify_all();
+	});
+}
+
+// Frees a loaded chunk.
+void ChunkManager::evictChunk(pair<int, int> key)
+{
+	delete loadedChunks[key].vao;
+	loadedChunks.erase(key);
+}
+
+// Gets the chunk containing a given world position.
+pair<int, int> ChunkManager::getChunkAt(vec3 pos)
+{
+	float chunkLength = (CHUNK_VERTICES - 1) * config.verticeOffset;
+
+	// Column increases with x, row increases as z decreases
+	float x = pos.x - TERRAIN_START.x - config.getStartPos();
+	float z = config.getStartPos() - (pos.z - TERRAIN_START.z);
+
+	return (make_pair((int)floor(x / chunkLength), (int)floor(z / chunkLength)));
+}
+
+// Distance between two chunks, in chunks (the larger of the x/z distances)
+int ChunkManager::getChunkDistance(pair<int, int> a, pair<int, int> b)
+{
+	return (std::max(abs(a.first - b.first), abs(a.second - b.second)));
+}
+
+// Called once per frame. Uploads a few finished chunks, frees chunks that are
+// out of range or over the memory budget, and queues any missing chunks
+// around the camera, nearest first.
+void ChunkManager::update(vec3 cameraPos)
+{
+	pair<int, int> centre = getChunkAt(cameraPos);
+
+	// Take finished chunks, up to the per-frame upload limit
+	vector<ChunkData*> finished;
+
+	{
+		lock_guard<mutex> lock(readyLock);
+
+		while (!readyChunks.empty() && finished.size() < CHUNK_UPLOADS_PER_FRAME)
+		{
+			finished.push_back(readyChunks.front());
+			readyChunks.pop_front();
+		}
+	}
+
+	for (int i = 0; i < finished.size(); i++)
+	{
+		pair<int, int> key = make_pair(finished[i]->chunkX, finished[i]->chunkZ);
+
+		pendingChunks.erase(key);
+
+		// Camera may have moved away while it was being generated
+		if (getChunkDistance(key, centre) <= STREAM_RADIUS)
+		{
+			uploadChunk(finished[i]);
+		}
+
+		delete finished[i];
+	}
+
+	// Free chunks that are out of range. One chunk of slack stops chunks
+	// being repeatedly freed and regenerated at the border.
+	vector<pair<int, int>> outOfRange;
+
+	for (auto it = loadedChunks.begin(); it != loadedChunks.end(); it++)
+	{
+		if (getChunkDistance(it->first, centre) > STREAM_RADIUS + 1)
+		{
+			outOfRange.push_back(it->first);
+		}
+	}
+
+	for (int i = 0; i < outOfRange.size(); i++)
+	{
+		evictChunk(outOfRange[i]);
+	}
+
+	// If still over budget, free the furthest chunks first
+	while (loadedChunks.size() > maxChunks)
+	{
+		auto furthest = loadedChunks.begin();
+
+		for (auto it = loadedChunks.begin(); it != loadedChunks.end(); it++)
+		{
+			if (getChunkDistance(it->first, centre) > getChunkDistance(furthest->first, centre))
+			{
+				furthest = it;
+			}
+		}
+
+		evictChunk(furthest->first);
+	}
+
+	// Find missing chunks in range
+	vector<pair<int, pair<int, int>>> missing;
+
+	for (int z = centre.second - STREAM_RADIUS; z <= centre.second + STREAM_RADIUS; z++)
+	{
+		for (int x = centre.first - STREAM_RADIUS; x <= centre.first + STREAM_RADIUS; x++)
+		{
+			pair<int, int> key = make_pair(x, z);
+
+			if (loadedChunks.count(key) == 0 && pendingChunks.count(key) == 0)
+			{
+				int dx = x - centre.first;
+				int dz = z - centre.second;
+
+				missing.push_back(make_pair(dx * dx + dz * dz, key));
+			}
+		}
+	}
+
+	sort(missing.begin(), missing.end());
+
+	// Only keep a couple of chunks per thread queued, so the queue doesn't fill
+	// with chunks the camera has already moved away from
+	int maxPending = ThreadPool::getShared()->getThreadCount() * 2;
+	int budgetLeft = maxChunks - (int)loadedChunks.size() - (int)pendingChunks.size();
+
+	for (int i = 0; i < missing.size() && pendingChunks.size() < maxPending && budgetLeft > 0; i++)
+	{
+		requestChunk(missing[i].second.first, missing[i].second.second);
+		budgetLeft--;
+	}
+}
+
+// Draws every loaded chunk. Assumes the terrain shaders and textures are
+// already bound.
+void ChunkManager::drawChunks()
+{
+	for (auto it = loadedChunks.begin(); it != loadedChunks.end(); it++)
+	{
+		it->second.vao->bind();
+
+		glDrawElements(GL_TRIANGLES, (GLsizei)chunkIndices.size(), GL_UNSIGNED_SHORT, 0);
+
+		it->second.vao->unbind();
+	}
+}
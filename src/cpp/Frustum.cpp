@@ -0,0 +1,51 @@
+#include "..\h\Frustum.h"
+
+// Default frustum - planes set so every box is visible.
+Frustum::Frustum()
+{
+	for (int i = 0; i < NUM_PLANES; i++)
+	{
+		planes[i] = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+// Extracts the six frustum planes from the rows of the matrix
+// (Gribb/Hartmann method). Planes are in whatever space the matrix
+// transforms from - e.g. model space for projection * view * model.
+Frustum::Frustum(mat4 mvpMatrix)
+{
+	vec4 rows[4];
+
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = vec4(mvpMatrix[0][i], mvpMatrix[1][i], mvpMatrix[2][i], mvpMatrix[3][i]);
+	}
+
+	planes[0] = rows[3] + rows[0];			// Left
+	planes[1] = rows[3] + rows[0] * -1.0f;	// Right
+	planes[2] = rows[3] + rows[1];			// Bottom
+	planes[3] = rows[3] + rows[1] * -1.0f;	// Top
+	planes[4] = rows[3] + rows[2];			// Near
+	planes[5] = rows[3] + rows[2] * -1.0f;	// Far
+}
+
+// Returns false only if the axis-aligned box is entirely outside one of
+// the planes.
+bool Frustum::isBoxVisible(vec3 boxMin, vec3 boxMax)
+{
+	for (int i = 0; i < NUM_PLANES; i++)
+	{
+		// Test the corner of the box furthest along the plane normal
+		vec3 corner;
+		corner.x = planes[i].x >= 0.0f ? boxMax.x : boxMin.x;
+		corner.y = planes[i].y >= 0.0f ? boxMax.y : boxMin.y;
+		corner.z = planes[i].z >= 0.0f ? boxMax.z : boxMin.z;
+
+		if (planes[i].x * corner.x + planes[i].y * corner.y + planes[i].z * corner.z + planes[i].w < 0.0f)
+		{
+			return (false);
+		}
+	}
+
+	return (true);
+}
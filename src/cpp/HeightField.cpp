@@ -0,0 +1,294 @@
+#include "..\h\HeightField.h"
+
+#include <math.h>
+#include <algorithm>
+
+// AVX2 (eight lanes, with gathers) is used for batches of samples when the
+// CPU has it - it is not on every x64 CPU, so it is checked for at runtime
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HEIGHTFIELD_AVX2
+#define HEIGHTFIELD_AVX2_TARGET
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HEIGHTFIELD_AVX2
+#define HEIGHTFIELD_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+using namespace glm;
+
+// Linear interpolation, written out so the single and batched samples are
+// worked out the same way whatever glm::mix does
+static inline float lerp(float x, float y, float a)
+{
+	return (x * (1.0f - a) + y * a);
+}
+
+// Sets up the grid bounds over the terrain's height and biome maps.
+HeightField::HeightField(const TerrainConfig& cfg, const TerrainGenerator* terrain)
+{
+	maps = terrain;
+
+	gridSize = cfg.gridSize;
+	verticeOffset = cfg.verticeOffset;
+
+	// Rows are generated front to back, so z decreases with each row
+	minX = cfg.getStartPos();
+	maxX = cfg.getStartPos() + (gridSize - 1) * verticeOffset;
+	maxZ = cfg.getStartPos();
+	minZ = cfg.getStartPos() - (gridSize - 1) * verticeOffset;
+}
+
+// Converts a terrain space position into a (fractional) column and row
+// on the grid, clamped to the edges of the map.
+void HeightField::getGridPos(float x, float z, float* col, float* row)
+{
+	*col = glm::clamp((x - minX) / verticeOffset, 0.0f, (float)(gridSize - 1));
+	*row = glm::clamp((maxZ - z) / verticeOffset, 0.0f, (float)(gridSize - 1));
+}
+
+// Returns the terrain height at the given position, interpolated
+// between the four vertices of the square it lies in.
+float HeightField::getHeight(float x, float z)
+{
+	float col, row;
+
+	getGridPos(x, z, &col, &row);
+
+	// Top left vertex of the square - kept one in from the last row/column
+	// so the square always has vertices on all four corners
+	int col0 = std::min((int)col, gridSize - 2);
+	int row0 = std::min((int)row, gridSize - 2);
+
+	float tx = col - col0;
+	float tz = row - row0;
+
+	int i = row0 * gridSize + col0;
+
+	float front = lerp(maps->getMapHeight(i), maps->getMapHeight(i + 1), tx);
+	float back = lerp(maps->getMapHeight(i + gridSize), maps->getMapHeight(i + gridSize + 1), tx);
+
+	return (lerp(front, back, tz));
+}
+
+// Returns the biome of the vertex closest to the given position, grouped
+// into the biomes with walking sounds - GRASS, DESERT or OASIS.
+TerrainGenerator::Biome HeightField::getBiome(float x, float z)
+{
+	float col, row;
+
+	getGridPos(x, z, &col, &row);
+
+	int i = (int)(row + 0.5f) * gridSize + (int)(col + 0.5f);
+
+	return (TerrainGenerator::biomeTable[maps->getMapBiome(i)].walkBiome);
+}
+
+// Returns the distance from the vertex closest to the given position to the
+// nearest oasis water.
+float HeightField::getWaterDistance(float x, float z)
+{
+	float col, row;
+
+	getGridPos(x, z, &col, &row);
+
+	return (maps->getWaterDistance((int)(row + 0.5f) * gridSize + (int)(col + 0.5f)));
+}
+
+// Whether the given position is within the bounds of the terrain.
+bool HeightField::isInside(float x, float z)
+{
+	return (x >= minX && x <= maxX && z >= minZ && z <= maxZ);
+}
+
+// Samples the height, normal and biome at one position. The height is
+// interpolated as in getHeight, the normal is that of the interpolated
+// surface (from its slope along the row and column), and the biome is that
+// of the closest vertex, grouped as in getBiome. Any of the outputs can be
+// NULL.
+void HeightField::getSample(float x, float z, float* height, vec3* normal, TerrainGenerator::Biome* biome)
+{
+	float col, row;
+
+	getGridPos(x, z, &col, &row);
+
+	int col0 = std::min((int)col, gridSize - 2);
+	int row0 = std::min((int)row, gridSize - 2);
+
+	float tx = col - col0;
+	float tz = row - row0;
+
+	int i = row0 * gridSize + col0;
+
+	float h00 = maps->getMapHeight(i);
+	float h01 = maps->getMapHeight(i + 1);
+	float h10 = maps->getMapHeight(i + gridSize);
+	float h11 = maps->getMapHeight(i + gridSize + 1);
+
+	if (height != NULL)
+	{
+		*height = lerp(lerp(h00, h01, tx), lerp(h10, h11, tx), tz);
+	}
+
+	if (normal != NULL)
+	{
+		// Height change across one square along the row (x) and down the
+		// rows (-z) - the same orientation as the vertex normals
+		float slopeX = lerp(h01 - h00, h11 - h10, tz);
+		float slopeZ = lerp(h10 - h00, h11 - h01, tx);
+
+		float length = sqrtf(slopeX * slopeX + verticeOffset * verticeOffset + slopeZ * slopeZ);
+
+		*normal = vec3(-slopeX / length, verticeOffset / length, slopeZ / length);
+	}
+
+	if (biome != NULL)
+	{
+		*biome = TerrainGenerator::biomeTable[maps->getMapBiome((int)(row + 0.5f) * gridSize + (int)(col + 0.5f))].walkBiome;
+	}
+}
+
+#ifdef HEIGHTFIELD_AVX2
+// Whether the CPU and OS support AVX2 - the CPU must have it, and the OS
+// must save the 256 bit registers.
+static bool hasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+
+	if (info[0] < 7)
+	{
+		return (false);
+	}
+
+	__cpuid(info, 1);
+
+	bool osSaves = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+
+	__cpuidex(info, 7, 0);
+
+	return (osSaves && (info[1] & (1 << 5)) != 0);
+#else
+	return (__builtin_cpu_supports("avx2") != 0);
+#endif
+}
+
+// lerp, eight at a time - the same operations, so the results match
+HEIGHTFIELD_AVX2_TARGET
+static inline __m256 lerp8(__m256 x, __m256 y, __m256 a)
+{
+	return (_mm256_add_ps(_mm256_mul_ps(x, _mm256_sub_ps(_mm256_set1_ps(1.0f), a)), _mm256_mul_ps(y, a)));
+}
+
+// getSample for eight positions at a time, gathering the four heights around
+// each from the float height map. Gives exactly the same results. Returns
+// how many positions were sampled (a multiple of eight) - the rest are left
+// to the caller.
+HEIGHTFIELD_AVX2_TARGET
+static int getSamplesAVX2(const float* heightMap, const unsigned char* biomeMap, int gridSize, float minX, float maxZ, float verticeOffset,
+	const float* x, const float* z, int count, float* heights, vec3* normals, TerrainGenerator::Biome* biomes)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 half = _mm256_set1_ps(0.5f);
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+	const __m256 lastVertex = _mm256_set1_ps((float)(gridSize - 1));
+	const __m256 offset = _mm256_set1_ps(verticeOffset);
+	const __m256 offsetSquared = _mm256_mul_ps(offset, offset);
+	const __m256i lastSquare = _mm256_set1_epi32(gridSize - 2);
+	const __m256i rowSize = _mm256_set1_epi32(gridSize);
+
+	int n = 0;
+
+	for (; n + 8 <= count; n += 8)
+	{
+		// Grid position, clamped to the map (as getGridPos)
+		__m256 col = _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(x + n), _mm256_set1_ps(minX)), offset);
+		__m256 row = _mm256_div_ps(_mm256_sub_ps(_mm256_set1_ps(maxZ), _mm256_loadu_ps(z + n)), offset);
+
+		col = _mm256_min_ps(_mm256_max_ps(col, zero), lastVertex);
+		row = _mm256_min_ps(_mm256_max_ps(row, zero), lastVertex);
+
+		__m256i col0 = _mm256_min_epi32(_mm256_cvttps_epi32(col), lastSquare);
+		__m256i row0 = _mm256_min_epi32(_mm256_cvttps_epi32(row), lastSquare);
+
+		__m256 tx = _mm256_sub_ps(col, _mm256_cvtepi32_ps(col0));
+		__m256 tz = _mm256_sub_ps(row, _mm256_cvtepi32_ps(row0));
+
+		__m256i front = _mm256_add_epi32(_mm256_mullo_epi32(row0, rowSize), col0);
+		__m256i back = _mm256_add_epi32(front, rowSize);
+
+		__m256 h00 = _mm256_i32gather_ps(heightMap, front, 4);
+		__m256 h01 = _mm256_i32gather_ps(heightMap + 1, front, 4);
+		__m256 h10 = _mm256_i32gather_ps(heightMap, back, 4);
+		__m256 h11 = _mm256_i32gather_ps(heightMap + 1, back, 4);
+
+		if (heights != NULL)
+		{
+			_mm256_storeu_ps(heights + n, lerp8(lerp8(h00, h01, tx), lerp8(h10, h11, tx), tz));
+		}
+
+		if (normals != NULL)
+		{
+			__m256 slopeX = lerp8(_mm256_sub_ps(h01, h00), _mm256_sub_ps(h11, h10), tz);
+			__m256 slopeZ = lerp8(_mm256_sub_ps(h10, h00), _mm256_sub_ps(h11, h01), tx);
+
+			__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(slopeX, slopeX), offsetSquared), _mm256_mul_ps(slopeZ, slopeZ)));
+
+			float nx[8], ny[8], nz[8];
+
+			_mm256_storeu_ps(nx, _mm256_div_ps(_mm256_xor_ps(slopeX, signBit), length));
+			_mm256_storeu_ps(ny, _mm256_div_ps(offset, length));
+			_mm256_storeu_ps(nz, _mm256_div_ps(slopeZ, length));
+
+			for (int i = 0; i < 8; i++)
+			{
+				normals[n + i] = vec3(nx[i], ny[i], nz[i]);
+			}
+		}
+
+		if (biomes != NULL)
+		{
+			__m256i nearestCol = _mm256_cvttps_epi32(_mm256_add_ps(col, half));
+			__m256i nearestRow = _mm256_cvttps_epi32(_mm256_add_ps(row, half));
+
+			int nearest[8];
+
+			_mm256_storeu_si256((__m256i*)nearest, _mm256_add_epi32(_mm256_mullo_epi32(nearestRow, rowSize), nearestCol));
+
+			for (int i = 0; i < 8; i++)
+			{
+				biomes[n + i] = TerrainGenerator::biomeTable[biomeMap[nearest[i]]].walkBiome;
+			}
+		}
+	}
+
+	return (n);
+}
+#endif
+
+// Samples the heights, normals and biomes at many positions at once, as
+// getSample does for one - for grounding many objects each frame. With AVX2
+// and a float height map, eight positions are sampled at a time. Any of the
+// outputs can be NULL if not needed.
+void HeightField::getSamples(const float* x, const float* z, int count, float* heights, vec3* normals, TerrainGenerator::Biome* biomes)
+{
+	int n = 0;
+
+#ifdef HEIGHTFIELD_AVX2
+	static const bool useAVX2 = hasAVX2();
+
+	// Half float heights are sampled one at a time
+	if (useAVX2 && !maps->getHeightMap().empty())
+	{
+		n = getSamplesAVX2(maps->getHeightMap().data(), maps->getBiomeMap().data(), gridSize, minX, maxZ, verticeOffset,
+			x, z, count, heights, normals, biomes);
+	}
+#endif
+
+	for (; n < count; n++)
+	{
+		getSample(x[n], z[n], heights != NULL ? heights + n : NULL, normals != NULL ? normals + n : NULL, biomes != NULL ? biomes + n : NULL);
+	}
+}
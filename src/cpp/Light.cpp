@@ -4,12 +4,11 @@
 // doesn't clip the edge of the terrain.
 #define LIGHT_ORBIT_OFFSET	8.0f;
 
+// irrKlang objects are reference counted - dropping them frees them, so
+// the sounds go before the engine that plays them. The shaders are freed
+// by ShaderInterface.
 Light::~Light()
 {
-	if (engine)
-	{
-		engine->drop();
-	}
 	if (sound)
 	{
 		sound->stop();
@@ -20,14 +19,12 @@ Light::~Light()
 		sound2->stop();
 		sound2->drop();
 	}
+	if (engine)
+	{
+		engine->drop();
+	}
 
-	free(sound);
-	free(sound2);
-	free(engine);
-	free(lightVAO);
-
-	glUseProgram(0);
-	free(shaders);
+	delete lightVAO;
 }
 
 vec3 Light::getLightPosition()
@@ -75,19 +72,19 @@ void Light::moveLight(double currTime)
 {
 	// Light positions for each prominent stage of day/night cycle
 	// Midday
-	float day1X = MIDDLE_POS;
-	float day1Y = MIDDLE_POS + LIGHT_ORBIT_OFFSET;
+	float day1X = middlePos;
+	float day1Y = middlePos + LIGHT_ORBIT_OFFSET;
 
 	// Sunset
-	float day2X = START_POS - LIGHT_ORBIT_OFFSET;
+	float day2X = startPos - LIGHT_ORBIT_OFFSET;
 	float day2Y = 0.0f;
 
 	// Midnight
-	float day3X = MIDDLE_POS;
-	float day3Y = -MIDDLE_POS - LIGHT_ORBIT_OFFSET;
+	float day3X = middlePos;
+	float day3Y = -middlePos - LIGHT_ORBIT_OFFSET;
 
 	// Sunrise
-	float day4X = END_POS + LIGHT_ORBIT_OFFSET;
+	float day4X = endPos + LIGHT_ORBIT_OFFSET;
 	float day4Y = 0.0f;
 
 	// Keeps track of the previous sky colour
@@ -105,9 +102,9 @@ void Light::moveLight(double currTime)
 	float tmaxXL, tmaxYL, tmaxZL, tminXL, tminYL, tminZL, tmaxVol1, tmaxVol2, tminVol1, tminVol2;
 
 	// Inflate radius so the light source can rotate around the centre point but remain outside of the actual terrain
-	float radius = MIDDLE_POS + LIGHT_ORBIT_OFFSET;
+	float radius = middlePos + LIGHT_ORBIT_OFFSET;
 
-	float centreX = MIDDLE_POS;
+	float centreX = middlePos;
 	float centreY = 0.0f;
 
 	// Get the current x and y coordinates of the light this frame
@@ -0,0 +1,44 @@
+#include "..\h\MemoryUsage.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
+#else
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
+size_t MemoryUsage::getResidentBytes()
+{
+	size_t bytes = 0;
+
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		bytes = counters.WorkingSetSize;
+	}
+#else
+	// Second value in statm is the resident size, in pages
+	FILE* file = fopen("/proc/self/statm", "r");
+
+	if (file != NULL)
+	{
+		unsigned long size, resident;
+
+		if (fscanf(file, "%lu %lu", &size, &resident) == 2)
+		{
+			bytes = (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+		}
+
+		fclose(file);
+	}
+#endif
+
+	return (bytes);
+}
@@ -0,0 +1,422 @@
+#include "..\h\MeshOptimiser.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <math.h>
+
+using namespace glm;
+
+#define FORSYTH_LAST_TRIANGLE	0.75f	// Score of the vertices of the last triangle added
+#define FORSYTH_CACHE_DECAY		1.5f	// How quickly the score falls further back in the cache
+#define FORSYTH_VALENCE_SCALE	2.0f	// Score of a vertex with one triangle left to add
+#define FORSYTH_VALENCE_POWER	0.5f	// How quickly that falls with more triangles left
+#define FORSYTH_VALENCE_TABLE	32		// Triangles left that the valence scores are worked out for
+
+// Forsyth's scores for a vertex's place in the cache and for how many
+// triangles it has left to add, worked out once
+struct ForsythScores
+{
+	float	cache[MESH_CACHE_SIZE];
+	float	valence[FORSYTH_VALENCE_TABLE];
+
+	ForsythScores()
+	{
+		for (int i = 0; i < MESH_CACHE_SIZE; i++)
+		{
+			// The last triangle's vertices get a fixed score, so the next
+			// triangle does not just reuse its newest edge
+			cache[i] = i < 3 ? FORSYTH_LAST_TRIANGLE : powf(1.0f - (float)(i - 3) / (MESH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY);
+		}
+
+		valence[0] = 0.0f;
+
+		for (int i = 1; i < FORSYTH_VALENCE_TABLE; i++)
+		{
+			valence[i] = FORSYTH_VALENCE_SCALE * powf((float)i, -FORSYTH_VALENCE_POWER);
+		}
+	}
+};
+
+static const ForsythScores forsythScores;
+
+// Score of a vertex - higher the nearer the front of the cache it is, and
+// the fewer triangles it has left to add (so vertices are finished off
+// rather than left to fall out of the cache). Vertices with no triangles
+// left score -1.
+static float getVertexScore(int cachePosition, int liveTriangles)
+{
+	if (liveTriangles == 0)
+	{
+		return (-1.0f);
+	}
+
+	float score = cachePosition >= 0 ? forsythScores.cache[cachePosition] : 0.0f;
+
+	score += liveTriangles < FORSYTH_VALENCE_TABLE ? forsythScores.valence[liveTriangles]
+		: FORSYTH_VALENCE_SCALE * powf((float)liveTriangles, -FORSYTH_VALENCE_POWER);
+
+	return (score);
+}
+
+// Counts the cache misses of an index list through a FIFO cache of
+// MESH_FIFO_SIZE vertices. A vertex is still in the cache if fewer than that
+// many misses have happened since it was loaded.
+template <typename Index>
+static MeshOptimiser::CacheStats analyseCache(const Index* indices, int indexCount, int vertexCount)
+{
+	MeshOptimiser::CacheStats stats = { indexCount / 3, 0, 0 };
+
+	vector<int> loadedAt(vertexCount, -1);
+
+	for (int i = 0; i < indexCount; i++)
+	{
+		int vertex = indices[i];
+
+		if (loadedAt[vertex] < 0)
+		{
+			stats.vertices++;
+		}
+
+		if (loadedAt[vertex] < 0 || stats.transformed - loadedAt[vertex] >= MESH_FIFO_SIZE)
+		{
+			loadedAt[vertex] = stats.transformed;
+			stats.transformed++;
+		}
+	}
+
+	return (stats);
+}
+
+// Forsyth's linear-speed vertex cache optimisation. Triangles are added one
+// at a time, always the one whose vertices score highest - the next is
+// picked from the triangles of the vertices in the cache, which are the
+// only ones whose scores change. When none are left (e.g. the end of a
+// separate part of the mesh), the next triangle not yet added is taken.
+template <typename Index>
+static void optimiseCache(Index* indices, int indexCount, int vertexCount)
+{
+	const int triangleCount = indexCount / 3;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles of each vertex, from adjacencyStarts[v], with the ones still
+	// to add (liveTriangles[v] of them) kept at the front
+	vector<int> liveTriangles(vertexCount, 0);
+	vector<int> adjacencyStarts(vertexCount + 1, 0);
+	vector<int> adjacency(triangleCount * 3);
+
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		liveTriangles[indices[i]]++;
+	}
+
+	for (int v = 0; v < vertexCount; v++)
+	{
+		adjacencyStarts[v + 1] = adjacencyStarts[v] + liveTriangles[v];
+	}
+
+	vector<int> filled(adjacencyStarts.begin(), adjacencyStarts.end() - 1);
+
+	for (int i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[filled[indices[i]]++] = i / 3;
+	}
+
+	vector<int> cachePositions(vertexCount, -1);
+	vector<float> vertexScores(vertexCount);
+	vector<float> triangleScores(triangleCount, 0.0f);
+	vector<bool> added(triangleCount, false);
+
+	for (int v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = getVertexScore(-1, liveTriangles[v]);
+	}
+
+	int best = 0;
+
+	for (int t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+		if (triangleScores[t] > triangleScores[best])
+		{
+			best = t;
+		}
+	}
+
+	vector<Index> ordered(triangleCount * 3);
+
+	// Newest first - the three extra entries hold the vertices pushed out
+	// by each new triangle, so their scores are updated too
+	int cache[MESH_CACHE_SIZE + 3];
+	int cacheCount = 0;
+	int nextUnadded = 0;
+
+	for (int n = 0; n < triangleCount; n++)
+	{
+		if (best < 0)
+		{
+			while (added[nextUnadded])
+			{
+				nextUnadded++;
+			}
+
+			best = nextUnadded;
+		}
+
+		added[best] = true;
+
+		const Index* triangle = indices + best * 3;
+
+		ordered[n * 3] = triangle[0];
+		ordered[n * 3 + 1] = triangle[1];
+		ordered[n * 3 + 2] = triangle[2];
+
+		int newCache[MESH_CACHE_SIZE + 3];
+		int newCount = 0;
+
+		for (int k = 0; k < 3; k++)
+		{
+			int vertex = triangle[k];
+
+			// Moved to the end of the vertex's live triangles, and dropped
+			int* triangles = &adjacency[adjacencyStarts[vertex]];
+			int last = --liveTriangles[vertex];
+
+			for (int j = 0; j <= last; j++)
+			{
+				if (triangles[j] == best)
+				{
+					std::swap(triangles[j], triangles[last]);
+					break;
+				}
+			}
+
+			if (std::find(newCache, newCache + newCount, vertex) == newCache + newCount)
+			{
+				newCache[newCount++] = vertex;
+			}
+		}
+
+		int triangleVertices = newCount;
+
+		for (int i = 0; i < cacheCount; i++)
+		{
+			if (std::find(newCache, newCache + triangleVertices, cache[i]) == newCache + triangleVertices)
+			{
+				newCache[newCount++] = cache[i];
+			}
+		}
+
+		for (int i = 0; i < newCount; i++)
+		{
+			int vertex = newCache[i];
+
+			cachePositions[vertex] = i < MESH_CACHE_SIZE ? i : -1;
+			vertexScores[vertex] = getVertexScore(cachePositions[vertex], liveTriangles[vertex]);
+		}
+
+		// Only the triangles of the vertices just moved have new scores
+		best = -1;
+		float bestScore = -1.0f;
+
+		for (int i = 0; i < newCount; i++)
+		{
+			int vertex = newCache[i];
+			const int* triangles = &adjacency[adjacencyStarts[vertex]];
+
+			for (int j = 0; j < liveTriangles[vertex]; j++)
+			{
+				int t = triangles[j];
+
+				triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+				if (triangleScores[t] > bestScore)
+				{
+					best = t;
+					bestScore = triangleScores[t];
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, MESH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	std::copy(ordered.begin(), ordered.end(), indices);
+}
+
+// Measures how well an index list uses the vertex cache.
+MeshOptimiser::CacheStats MeshOptimiser::analyseVertexCache(const unsigned short* indices, int indexCount, int vertexCount)
+{
+	return (analyseCache(indices, indexCount, vertexCount));
+}
+
+MeshOptimiser::CacheStats MeshOptimiser::analyseVertexCache(const unsigned int* indices, int indexCount, int vertexCount)
+{
+	return (analyseCache(indices, indexCount, vertexCount));
+}
+
+// Reorders the triangles of an index list to reuse the vertex cache.
+void MeshOptimiser::optimiseVertexCache(unsigned short* indices, int indexCount, int vertexCount)
+{
+	optimiseCache(indices, indexCount, vertexCount);
+}
+
+void MeshOptimiser::optimiseVertexCache(unsigned int* indices, int indexCount, int vertexCount)
+{
+	optimiseCache(indices, indexCount, vertexCount);
+}
+
+// Reorders the runs of triangles in a cache optimised index list to cut
+// overdraw. A new run starts wherever a triangle misses the cache on all
+// three vertices, so moving whole runs costs almost no cache use. Runs are
+// drawn in order of how far out from the middle of the mesh they face.
+// Positions are the first three floats of each vertex, stride bytes apart.
+void MeshOptimiser::optimiseOverdraw(unsigned int* indices, int indexCount, const float* positions, int stride, int vertexCount)
+{
+	const int triangleCount = indexCount / 3;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	auto getPosition = [&](unsigned int vertex)
+	{
+		const float* position = (const float*)((const char*)positions + (size_t)vertex * stride);
+
+		return (vec3(position[0], position[1], position[2]));
+	};
+
+	// First triangle of each run, with the end as the last
+	vector<int> runStarts;
+	vector<int> loadedAt(vertexCount, -1);
+	int transformed = 0;
+
+	for (int t = 0; t < triangleCount; t++)
+	{
+		int misses = 0;
+
+		for (int k = 0; k < 3; k++)
+		{
+			int vertex = indices[t * 3 + k];
+
+			if (loadedAt[vertex] < 0 || transformed - loadedAt[vertex] >= MESH_FIFO_SIZE)
+			{
+				loadedAt[vertex] = transformed;
+				transformed++;
+				misses++;
+			}
+		}
+
+		if (t == 0 || misses == 3)
+		{
+			runStarts.push_back(t);
+		}
+	}
+
+	runStarts.push_back(triangleCount);
+
+	int runCount = (int)runStarts.size() - 1;
+
+	if (runCount < 2)
+	{
+		return;
+	}
+
+	// Middle of the mesh, weighting each triangle by its area
+	vec3 meshCentre(0.0f);
+	float meshArea = 0.0f;
+
+	vector<vec3> runCentres(runCount, vec3(0.0f));
+	vector<vec3> runNormals(runCount, vec3(0.0f));
+	vector<float> runAreas(runCount, 0.0f);
+
+	for (int run = 0; run < runCount; run++)
+	{
+		for (int t = runStarts[run]; t < runStarts[run + 1]; t++)
+		{
+			vec3 a = getPosition(indices[t * 3]);
+			vec3 b = getPosition(indices[t * 3 + 1]);
+			vec3 c = getPosition(indices[t * 3 + 2]);
+
+			// Twice the area, pointing along the normal
+			vec3 normal = cross(b - a, c - a);
+			float area = length(normal);
+
+			runCentres[run] += (a + b + c) * (area / 3.0f);
+			runNormals[run] += normal;
+			runAreas[run] += area;
+		}
+
+		meshCentre += runCentres[run];
+		meshArea += runAreas[run];
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentre /= meshArea;
+	}
+
+	vector<float> runKeys(runCount, 0.0f);
+	vector<int> runOrder(runCount);
+
+	for (int run = 0; run < runCount; run++)
+	{
+		float normalLength = length(runNormals[run]);
+
+		if (runAreas[run] > 0.0f && normalLength > 0.0f)
+		{
+			runKeys[run] = dot(runCentres[run] / runAreas[run] - meshCentre, runNormals[run] / normalLength);
+		}
+
+		runOrder[run] = run;
+	}
+
+	std::stable_sort(runOrder.begin(), runOrder.end(), [&](int a, int b) { return (runKeys[a] > runKeys[b]); });
+
+	vector<unsigned int> ordered;
+	ordered.reserve(indexCount);
+
+	for (int run : runOrder)
+	{
+		ordered.insert(ordered.end(), indices + runStarts[run] * 3, indices + runStarts[run + 1] * 3);
+	}
+
+	std::copy(ordered.begin(), ordered.end(), indices);
+}
+
+// Renumbers the vertices in the order the index list first uses them, with
+// any unused ones last. remap gives each old vertex's new number - the
+// caller moves the vertices to match.
+void MeshOptimiser::optimiseVertexFetch(unsigned int* indices, int indexCount, int vertexCount, vector<int>* remap)
+{
+	remap->assign(vertexCount, -1);
+
+	int next = 0;
+
+	for (int i = 0; i < indexCount; i++)
+	{
+		int& vertex = (*remap)[indices[i]];
+
+		if (vertex < 0)
+		{
+			vertex = next++;
+		}
+
+		indices[i] = (unsigned int)vertex;
+	}
+
+	for (int v = 0; v < vertexCount; v++)
+	{
+		if ((*remap)[v] < 0)
+		{
+			(*remap)[v] = next++;
+		}
+	}
+}
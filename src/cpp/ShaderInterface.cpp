@@ -21,7 +21,7 @@ ShaderInterface::ShaderInterface(string v, string f, int* err)
 ShaderInterface::~ShaderInterface()
 {
 	glUseProgram(0);
-	free(shaders);
+	delete shaders;
 }
 
 // Sends MVP data to the shaders
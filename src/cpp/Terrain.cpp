@@ -1,53 +1,131 @@
 #include "..\h\Terrain.h"
 
 // Noise - height maps, model placement
-#include "..\h\FastNoiseLite.h"
+#include "..\h\TerrainNoise.h"
+
+#include "..\h\ThreadPool.h"
+#include "..\h\ChunkManager.h"
+#include "..\h\TerrainLOD.h"
+#include "..\h\TerrainDisplacement.h"
+#include "..\h\HeightField.h"
+#include "..\h\TerrainRegions.h"
+#include "..\h\TerrainDistance.h"
+#include "..\h\TerrainRTIN.h"
+#include "..\h\MeshOptimiser.h"
+#include "..\h\TerrainCache.h"
+#include "..\h\Frustum.h"
+#include "..\h\MemoryUsage.h"
 
 #include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <utility>
 
 using namespace glm;
 
-// Defines the boundaries the noise values must exceed
-// for a model to be placed in the grass & oasis biomes
-#define GRASS_MODEL_BOUND	0.95f
-#define OASIS_MODEL_BOUND	0.99f
-
 Terrain::~Terrain()
 {
-	if (engine)
+	// Wait for a world still being generated before freeing anything
+	if (nextWorld != NULL)
 	{
-		engine->drop();
+		{
+			unique_lock<mutex> lock(nextWorld->lock);
+			nextWorld->generatedSignal.wait(lock, [this]() { return (nextWorld->generated); });
+		}
+
+		if (nextWorld->fence != NULL)
+		{
+			glDeleteSync(nextWorld->fence);
+		}
+
+		delete nextWorld->vao;
+		delete nextWorld->lod;
+		delete nextWorld->displacement;
+		delete nextWorld->generator;
+		delete nextWorld->regions;
+		delete nextWorld;
+	}
+
+	// And for any regions or water distances still being found
+	if (mapRebuild != NULL)
+	{
+		{
+			unique_lock<mutex> lock(mapRebuild->lock);
+			mapRebuild->doneSignal.wait(lock, [this]() { return (mapRebuild->done); });
+		}
+
+		delete mapRebuild->regions;
+		delete mapRebuild;
 	}
+
+	// irrKlang objects are reference counted - dropping them frees them, so
+	// the sound goes before the engine that plays it
 	if (sound)
 	{
 		sound->stop();
 		sound->drop();
 	}
+	if (engine)
+	{
+		engine->drop();
+	}
 
-	free(sound);
-	free(engine);
-	free(terrainVAO);
+	delete terrainVAO;
+	delete chunkManager;
+	delete terrainLOD;
+	delete terrainDisplacement;
+	delete heightField;
+	delete regions;
 
-	glUseProgram(0);
-	free(shaders);
+	// The shaders are freed by ShaderInterface
 }
 
-// Sets the tree that will have a 3D sound attached to it
+// Sets the tree that will have a 3D sound attached to it - the tree closest
+// to the middle of the largest oasis
 void Terrain::setSoundTree()
 {
-	int i = 0;
+	// Streamed worlds have no regions
+	if (regions == NULL)
+	{
+		return;
+	}
+
+	int oasis = regions->getLargestRegion(REGION_OASIS);
+
+	if (oasis < 0)
+	{
+		return;
+	}
+
+	vec2 centroid = regions->getRegions()[oasis].centroid;
+	float closest = 0.0f;
 	bool found = false;
 
-	// Search for a tree and use its position for the 3D sound
-	while (i < oasisModelPositions.size() && !found)
+	// Search the trees for the closest one and use its position for the 3D sound
+	for (int i = 0; i < oasisModelPositions.size(); i++)
 	{
-		if (modelType[i])
+		vec2 offset = vec2(oasisModelPositions[i].x, oasisModelPositions[i].z) - centroid;
+		float distance = dot(offset, offset);
+
+		if (getModelType(i) && (!found || distance < closest))
 		{
 			soundTreeModel = vec3(oasisModelPositions[i]);
+			closest = distance;
 			found = true;
 		}
+	}
+
+	// On the ground the tree is drawn on (see ModelSet)
+	if (found)
+	{
+		float x = TERRAIN_START.x + soundTreeModel.x;
+		float z = TERRAIN_START.z + soundTreeModel.z;
+		float height;
+
+		getGroundSamples(&x, &z, 1, &height, NULL, NULL);
 
-		i++;
+		soundTreeModel.y = height - TERRAIN_START.y;
 	}
 
 	if (engine && soundTreeModel.x != 0.0f && soundTreeModel.y != 0.0f && soundTreeModel.z != 0.0f)
@@ -69,547 +147,1455 @@ void Terrain::updateListenerPosition(vec3 pos, vec3 front)
 // Draws the terrain data within the terrain VAO
 void Terrain::drawTerrain()
 {
+	// Carry on uploading a regenerated world, swapping it in once it is ready
+	updateRegeneration();
+
+	// Bring the normals and GPU vertices up to date with any edits
+	applyEdits();
+
 	for (int i = 0; i < textures.size(); i++)
 	{
 		textures[i]->bindTexture();
 	}
 
-	terrainVAO->bind();
+	// When streaming, the chunks around the camera are drawn instead
+	// of the fixed terrain mesh
+	if (chunkManager != NULL)
+	{
+		chunkManager->drawChunks();
+	}
+	else if (terrainLOD != NULL)
+	{
+		terrainLOD->drawTerrain(terrainCameraPos, terrainMVP);
+	}
+	else if (terrainDisplacement != NULL)
+	{
+		terrainDisplacement->drawTerrain();
+	}
+	else
+	{
+		if (config.packVertices)
+		{
+			shaders->use();
+			shaders->setInt("renderMode", 3);
+			shaders->setFloat("heightScale", packedHeightScale);
+			shaders->setFloat("heightMin", packedHeightMin);
+		}
 
-	glDrawElements(GL_TRIANGLES, MAP_SIZE * 32, GL_UNSIGNED_INT, 0);
+		terrainVAO->bind();
 
-	terrainVAO->unbind();
+		drawMeshChunks();
+
+		terrainVAO->unbind();
+
+		if (config.packVertices)
+		{
+			shaders->setInt("renderMode", 0);
+		}
+	}
 }
 
-// Sets up VAO for terrain data, including vertices, colours, normals
-// and textures
-void Terrain::createTerrainVAO()
+// Starts streaming the terrain in as chunks around the camera, so the world
+// continues past the edges of the generated map.
+void Terrain::enableStreaming()
 {
-	terrainVAO = new VAO();
-	terrainVAO->bind();
+	if (chunkManager == NULL)
+	{
+		chunkManager = new ChunkManager(config);
+	}
+}
 
-	int verticesArrSize = sizeof(terrainVertices);
-	int indicesArrSize = sizeof(terrainIndices);
+// Switches to drawing the terrain with distance-based level of detail, so
+// far away areas use fewer triangles. Needs the framebuffer height to work
+// out how large height errors appear on screen.
+void Terrain::enableLOD(float screenHeight)
+{
+	if (terrainLOD == NULL)
+	{
+		// The LOD textures and error ranges are worked out from float heights
+		vector<float> unpacked;
 
-	// Bind terrain vertices and indices to buffers
-	terrainVAO->addBuffer(terrainVertices, verticesArrSize, VAO::VERTICES);
-	terrainVAO->addBuffer(terrainIndices, indicesArrSize, VAO::INDICES);
+		terrainLOD = new TerrainLOD(config, getFloatHeights(&unpacked), biomeMap, screenHeight, shaders);
+		terrainLOD->uploadTextures(numeric_limits<int>::max());
+		lodScreenHeight = screenHeight;
+	}
+}
 
-	terrainVAO->enableAttribArrays(BUF_VERTICES | BUF_COLOURS | BUF_NORMALS | BUF_TEXTURES);
+// Updates the window height the LOD levels are picked for - called when the
+// window is resized.
+void Terrain::setScreenHeight(float screenHeight)
+{
+	lodScreenHeight = screenHeight;
 
-	terrainVAO->unbind();
+	if (terrainLOD != NULL)
+	{
+		terrainLOD->setScreenHeight(screenHeight);
+	}
 }
 
-// Generates and binds all the textures needed for the terrain.
-void Terrain::setTextures()
+// Returns the height map as floats - the map itself, or when it is stored as
+// half floats, the given vector filled with the unpacked heights.
+const vector<float>& Terrain::getFloatHeights(vector<float>* unpacked)
 {
-	for (int i = 0; i < NUM_TEXTURES; i++)
+	if (halfHeightMap.empty())
 	{
-		TerrainTexture* tex = new TerrainTexture(assetsFolder + TerrainTexture::texNames[i], (TerrainTexture::TerrainType)i, shaders);
-		tex->bindTexture();
+		return (heightMap);
+	}
 
-		textures.push_back(tex);
+	unpacked->resize(config.getMapSize());
+
+	for (int i = 0; i < config.getMapSize(); i++)
+	{
+		(*unpacked)[i] = getMapHeight(i);
 	}
+
+	return (*unpacked);
 }
 
-// Returns either 0 (grass model) or 1 (tree or cactus model, depending on the biome) 
-// to determine a randomised model at a given position.
-const int Terrain::getModelType(int idx)
+// Returns the number of triangles drawn for the terrain in the last frame.
+int Terrain::getDrawnTriangles()
 {
-	return (modelType[idx]);
+	int triangles = drawnTriangles;
+
+	if (terrainLOD != NULL)
+	{
+		triangles = terrainLOD->getDrawnTriangles();
+	}
+	else if (terrainDisplacement != NULL)
+	{
+		triangles = terrainDisplacement->getDrawnTriangles();
+	}
+
+	return (triangles);
 }
 
-// Retrieves a rotation value from a selection of randomly generated values to apply
-// to a given model.
-const int Terrain::getRotation(int idx)
+// Returns the number of terrain mesh triangles skipped in the last frame for
+// being outside the view frustum.
+int Terrain::getCulledTriangles()
 {
-	return (rotation[idx]);
+	return (culledTriangles);
 }
 
-// Retrieves a scaling factor (divisor) from a selection of randomly generated values
-// to apply to a given model.
-const int Terrain::getScale(int idx)
+// Sends the MVP matrix to the shaders, and keeps a copy for culling and LOD selection.
+void Terrain::setMVP(MVP* mvp)
 {
-	return (scaling[idx]);
+	ShaderInterface::setMVP(mvp);
+
+	terrainMVP = mvp->getProjection() * mvp->getView() * mvp->getModel();
 }
 
-// Gets the biome type at a given point on the terrain given the relevant
-// noise values
-Terrain::Biome Terrain::getBiome(float terrain, float path)
+// Sends the light/camera positions to the shaders, and keeps the camera
+// position (relative to the terrain) for LOD selection.
+void Terrain::setShaderPositions(vec3 lightPos, vec3 cameraPos)
 {
-	Biome biome = DESERT;
+	ShaderInterface::setShaderPositions(lightPos, cameraPos);
 
-	// Grassy biome. This is where grass and cacti will also appear.
-	if (terrain >= 0.55f)
-	{
-		biome = GRASS;
-	}
-	// If the terrain is just below grass biome level - allow the textures
-	// to mix between grass/sand
-	else if (terrain < 0.55 && terrain >= 0.5)
-	{
-		biome = GRASS_DESERT;
-	}
-	// If terrain height is below -0.35, set to oasis
-	// (water) biome
-	else if (terrain <= -0.35f)
+	terrainCameraPos = cameraPos - TERRAIN_START;
+}
+
+// Loads/unloads streamed chunks around the camera. Does nothing unless
+// config.streamChunks is set.
+void Terrain::updateStreaming(vec3 cameraPos)
+{
+	if (chunkManager != NULL)
 	{
-		biome = OASIS;
+		chunkManager->update(cameraPos);
 	}
-	// If the terrain is just above water biome level - allow the textures
-	// to mix between water/sand
-	// Trees will also appear here to surround the water and flesh out the
-	// oasis biome
-	else if (terrain > -0.35 && terrain <= -0.3)
+}
+
+// Generates the terrain and uploads it to the GPU. When caching is enabled
+// and an earlier run saved a terrain with the same settings, it is loaded
+// from the cache instead and the file is uploaded to the GPU directly,
+// skipping generation.
+void Terrain::buildTerrain()
+{
+	TerrainCache cache(config);
+
+	auto genStart = chrono::steady_clock::now();
+
+	if (config.displaceOnGPU)
 	{
-		biome = DESERT_OASIS;
+		// Only the heights, biomes and model positions are needed - the mesh
+		// (indices, texture coordinates and normals) is built in the shader.
+		// Not cached, as the cache holds the full mesh.
+		generate(true);
+
+		auto genEnd = chrono::steady_clock::now();
+
+		cout << "Generated " << config.gridSize << "x" << config.gridSize << " height map in "
+			<< chrono::duration<double, milli>(genEnd - genStart).count() << " ms\n";
+
+		createHeightField();
+		terrainDisplacement = new TerrainDisplacement(config, heightMap, biomeMap, shaders);
+		terrainDisplacement->uploadTextures(numeric_limits<int>::max());
 	}
-	// Generate pathways - alternate sand colour to add interest to main
-	// desert biome
-	else if (path < 0.2f)
+	else if (config.useCache && cache.load())
 	{
-		biome = DESERT_PATH;
+		loadTerrain(&cache);
+
+		auto genEnd = chrono::steady_clock::now();
+
+		cout << "Loaded " << config.gridSize << "x" << config.gridSize << " terrain from " << cache.getFileName() << " in "
+			<< chrono::duration<double, milli>(genEnd - genStart).count() << " ms\n";
+
+		createHeightField();
+		generateIndices();
+		createMeshChunks(*this, chunkIndexStarts, &meshChunks);
+		createTerrainVAO(cache.getVertices());
 	}
-	// Main desert (sand) biome.
 	else
 	{
-		biome = DESERT;
-	}
+		generate();
+		generateIndices();
 
-	return (biome);
-}
+		auto genEnd = chrono::steady_clock::now();
 
-// Gets if a model should be placed at a given position, provided
-// the biome and generated noise value
-bool Terrain::getIfModelPlacement(Biome biome, float noise)
-{
-	bool placeModel = false;
+		cout << "Generated " << config.gridSize << "x" << config.gridSize << " terrain in "
+			<< chrono::duration<double, milli>(genEnd - genStart).count() << " ms\n";
 
-	switch (biome)
-	{
-	case GRASS:
-		if (noise > GRASS_MODEL_BOUND)
-		{
-			placeModel = true;
-		}
-		break;
-	case DESERT_OASIS:
-		if (noise > OASIS_MODEL_BOUND)
+		// The GPU (and the cache) hold the vertices chunk by chunk
+		vector<VAO::VertexData> chunkVertices;
+		createChunkVertices(&chunkVertices);
+
+		if (config.useCache)
 		{
-			placeModel = true;
+			cache.save(chunkVertices, grassModelPositions, oasisModelPositions, heightMap, biomeMap);
 		}
-		break;
-	default:
-		break;
-	}
 
-	return (placeModel);
+		createHeightField();
+		createMeshChunks(*this, chunkIndexStarts, &meshChunks);
+		createTerrainVAO(chunkVertices.data());
+	}
 }
 
-// Retrieves all of the established model positions for the grassy
-// biomes and copies them into the provided vector.
-void Terrain::getGrassModelPositions(vector<vec3>* positions)
+// Copies a cached terrain out of the mapped file. The vertices are stored
+// chunk by chunk, as uploaded to the GPU, so each row of the map is gathered
+// back out of the chunks it runs through.
+void Terrain::loadTerrain(TerrainCache* cache)
 {
-	for (int i = 0; i < grassModelPositions.size(); i++)
+	const TerrainCache::Header* header = cache->getHeader();
+	const VAO::VertexData* chunkVertices = cache->getVertices();
+
+	const int chunks = config.getDrawChunks();
+	const int chunkSide = DRAW_CHUNK_QUADS + 1;
+
+	terrainVertices.resize(config.getMapSize());
+
+	ThreadPool::getShared()->parallelFor(config.gridSize, [&](int row)
 	{
-		positions->push_back(grassModelPositions[i]);
-	}
+		// The last row/column of a chunk is also the first of the next, and
+		// the final chunk holds the rest of the map
+		int chunkRow = std::min(row / DRAW_CHUNK_QUADS, chunks - 1);
+		int localRow = row - chunkRow * DRAW_CHUNK_QUADS;
+
+		for (int chunkCol = 0; chunkCol < chunks; chunkCol++)
+		{
+			int firstCol = chunkCol * DRAW_CHUNK_QUADS;
+			int endCol = chunkCol == chunks - 1 ? config.gridSize : firstCol + DRAW_CHUNK_QUADS;
+
+			const VAO::VertexData* src = chunkVertices + (size_t)(chunkRow * chunks + chunkCol) * config.getDrawChunkVertices() + localRow * chunkSide;
+
+			memcpy(&terrainVertices[row * config.gridSize + firstCol], src, (endCol - firstCol) * sizeof(VAO::VertexData));
+		}
+	});
+
+	// The maps are stored as they were generated, rather than worked back
+	// out of the vertices
+	heightMap.assign(cache->getHeightMap(), cache->getHeightMap() + config.getMapSize());
+	biomeMap.assign(cache->getBiomeMap(), cache->getBiomeMap() + config.getMapSize());
+
+	createWaterDistanceMap();
+
+	grassModelPositions.assign(cache->getGrassPositions(), cache->getGrassPositions() + header->grassCount);
+	oasisModelPositions.assign(cache->getOasisPositions(), cache->getOasisPositions() + header->oasisCount);
 }
 
-// Retrieves all of the established model positions for the oasis
-// biomes and copies them into the provided vector.
-void Terrain::getOasisModelPositions(vector<vec3>* positions)
+// Builds the height/biome grid used to place the user on the terrain
+void Terrain::createHeightField()
 {
-	for (int i = 0; i < oasisModelPositions.size(); i++)
-	{
-		positions->push_back(oasisModelPositions[i]);
-	}
+	heightField = new HeightField(config, this);
 }
 
-// Generate all of the vertices and indices for the terrain
-void Terrain::generateVertices()
+// Splits the biome map into regions (see TerrainRegions), replacing any
+// from before, and prints how many there are.
+void Terrain::labelRegions()
 {
-	for (int i = 0; i < MAP_SIZE; i++)
-	{
-		// Generate vertices and colours for each triangle
-
-		// Vertices
-		terrainVertices[i].vertices.x = colVerticesOffset;	// x axis: -->
-		terrainVertices[i].vertices.y = 0.0f;				// y axis - up ^ direction, so 0 - using Perlin noise for height maps
-		terrainVertices[i].vertices.z = rowVerticesOffset;	// z axis - forward direction (looking at terrain at level view)
+	vector<float> unpacked;
 
-		// Set normals to 0 for now
-		terrainVertices[i].normals.x = 0.0f;
-		terrainVertices[i].normals.y = 0.0f;
-		terrainVertices[i].normals.z = 0.0f;
-		normalsCalc[i] = 0;
+	delete regions;
+	regions = new TerrainRegions(config, biomeMap, getFloatHeights(&unpacked));
 
-		// Move x position for next triangle on the grid - draws L->R >>>
-		colVerticesOffset += VERTICE_OFFSET;
+	cout << "Found " << regions->getRegionCount(REGION_OASIS) << " oases and " << regions->getRegionCount(REGION_GRASS)
+		<< " grassland patches in " << regions->getLabelMs() << " ms\n";
+}
 
-		// Increment chunk index within this row
-		rowIndex++;
+// Frees the CPU copy of the mesh now that it is on the GPU (unless keepMesh
+// is set), leaving the height and biome maps to answer queries and rebuild
+// edited vertices, and prints where the terrain's memory has gone.
+void Terrain::releaseMesh()
+{
+	size_t residentBefore = MemoryUsage::getResidentBytes();
+	size_t meshBytes = terrainVertices.capacity() * sizeof(VertexData);
 
-		// If at the end of the row
-		if (rowIndex == RENDER_DIST)
-		{
-			// Reset row index
-			rowIndex = 0;
+	// An adaptive mesh's indices are kept, to rebuild the chunks that are
+	// edited. The index pattern is only needed to fill the index buffer.
+	if (!isAdaptive())
+	{
+		meshBytes += chunkIndices.capacity() * sizeof(GLushort);
+	}
 
-			// Reset x & z positions for the next row
+	if (!config.keepMesh)
+	{
+		releaseVertices(config.halfHeights);
 
-			// Column is reset back to the start
-			colVerticesOffset = drawStartPos;
-			// Row is decreased (moved backwards on z axis) - move back a row - draws front -> back ^^^
-			rowVerticesOffset -= VERTICE_OFFSET;
+		if (!isAdaptive())
+		{
+			vector<GLushort>().swap(chunkIndices);
 		}
 	}
 
-	rowIndex = 0;
+	size_t residentAfter = MemoryUsage::getResidentBytes();
+
+	cout << "Terrain memory:\n";
 
-	// Go up in twos - 2 triangles per one chunk
-	for (int i = 0; i < TOTAL_TRIANGLES; i += 2)
+	if (terrainVAO != NULL)
 	{
-		// Generate the indices by mapping the above to chunks (1x1 squares)
+		size_t vertexSize = config.packVertices ? sizeof(VAO::PackedVertexData) : sizeof(VAO::VertexData);
 
-		terrainIndices[i].x = colIndicesOffset + rowIndicesOffset;					// Top left				 _
-		terrainIndices[i].z = RENDER_DIST + colIndicesOffset + rowIndicesOffset;	// Bottom left			|/
-		terrainIndices[i].y = 1 + colIndicesOffset + rowIndicesOffset;				// Top right
+		size_t indexCount = isAdaptive() ? chunkIndices.size() : (size_t)config.getDrawChunkIndices();
 
-		terrainIndices[i + 1].x = 1 + colIndicesOffset + rowIndicesOffset;					// Top right		/|
-		terrainIndices[i + 1].z = RENDER_DIST + colIndicesOffset + rowIndicesOffset;		// Bottom left		-
-		terrainIndices[i + 1].y = 1 + RENDER_DIST + colIndicesOffset + rowIndicesOffset;	// Bottom right
+		cout << "  GPU mesh: " << (size_t)config.getDrawVertexCount() * vertexSize / 1024 << " KB vertices, "
+			<< indexCount * sizeof(GLushort) << " bytes of indices\n";
+	}
 
-		// Move x position for next triangle on the grid
-		colIndicesOffset += 1;
+	cout << "  CPU mesh: " << meshBytes / 1024 << (config.keepMesh ? " KB kept\n" : " KB released\n");
 
-		// Increment chunk index within this row
-		rowIndex++;
+	if (isAdaptive())
+	{
+		cout << "  CPU adaptive indices: " << chunkIndices.capacity() * sizeof(GLushort) / 1024 << " KB kept\n";
+	}
+	cout << "  CPU maps: " << getMapBytes() / 1024 << " KB (" << (halfHeightMap.empty() ? "32" : "16") << " bit heights, 8 bit biomes, 16 bit water distances)\n";
 
-		// If at the end of the row
-		if (rowIndex == ROW_CHUNKS)
-		{
-			// Reset row index
-			rowIndex = 0;
+	if (residentBefore > 0)
+	{
+		cout << "  Process resident: " << residentBefore / (1024 * 1024) << " MB -> " << residentAfter / (1024 * 1024) << " MB\n";
+	}
+}
+
+// Sets up VAO for terrain data, including vertices, colours, normals
+// and textures
+void Terrain::createTerrainVAO(const VAO::VertexData* vertexData)
+{
+	int indicesArrSize = (int)(chunkIndices.size() * sizeof(GLushort));
 
-			// Reset x & z positions for the next row
+	cout << "Terrain index buffer is " << indicesArrSize << " bytes ("
+		<< (size_t)config.getTotalTriangles() * sizeof(ivec3) / 1024 << " KB as 32 bit triangles)\n";
 
-			// Column is reset back to the start
-			colIndicesOffset = 0;
-			// Move back a row
-			rowIndicesOffset = rowIndicesOffset + RENDER_DIST;
-		}
+	if (config.packVertices)
+	{
+		createPackedTerrainVAO(vertexData);
+		return;
 	}
+
+	terrainVAO = createMeshVAO(vertexData, (int)(config.getDrawVertexCount() * sizeof(VAO::VertexData)), chunkIndices);
 }
 
-// Generate height maps for the terrain with Perlin noise,
-// as well as create colour map based on biomes as a template for
-// the textures for the shader.
-void Terrain::generateLandscape()
+// Creates a VAO for the terrain mesh - a vertex buffer of the given size, in
+// the full or packed layout, and the chunk indices. With no vertex data, the
+// buffer is allocated to be filled later.
+VAO* Terrain::createMeshVAO(const void* vertexData, int size, const vector<GLushort>& indices)
 {
-	// Assign perlin noise type for the map. This affects the y axis
-	FastNoiseLite terrainNoise;
-	terrainNoise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-	// Set noise scale
-	terrainNoise.SetFrequency(0.025f);
-	// Generate random seed
-	int seed = rand() % 100;
-	terrainNoise.SetSeed(seed);
+	VAO* vao = new VAO();
+	vao->bind();
 
-	// Perlin noise for pathway map
-	FastNoiseLite pathNoise;
-	pathNoise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-	pathNoise.SetFrequency(0.05f);
-	int pSeed = rand() % 100;
-	pathNoise.SetSeed(pSeed);
+	vao->addBuffer(vertexData, size, VAO::VERTICES);
+	vao->addBuffer(indices.data(), (int)(indices.size() * sizeof(GLushort)), VAO::INDICES);
+
+	if (config.packVertices)
+	{
+		vao->enableAttribArrays(BUF_PACKED | BUF_VERTICES | BUF_COLOURS | BUF_NORMALS);
+	}
+	else
+	{
+		vao->enableAttribArrays(BUF_VERTICES | BUF_COLOURS | BUF_NORMALS | BUF_TEXTURES);
+	}
 
-	// OpenSimplex noise for model placement - OS seems to give more "extreme" values closer together -
-	// when tested on terrain, there were considerably more hills and troughs, with less in between values.
-	FastNoiseLite modelNoise;
-	modelNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
-	modelNoise.SetFrequency(10.0f);
-	int tSeed = rand() % 100;
-	modelNoise.SetSeed(tSeed);
+	vao->unbind();
 
-	// Terrain vertice index
-	int terrainIndex = 0;
+	return (vao);
+}
 
-	float terrainVal = 0.0f;
-	float pathVal = 0.0f;
-	float modelsVal = 0.0f;
+// Sets up the terrain VAO with vertices packed into the compact 12 byte
+// layout. The terrain shader works out x/z and texture coordinates from the
+// vertex index, and decodes the heights and normals.
+void Terrain::createPackedTerrainVAO(const VAO::VertexData* vertexData)
+{
+	vector<VAO::PackedVertexData> packedVertices;
 
-	Biome currBiome = DESERT;
+	packVertices(vertexData, config.getDrawVertexCount(), &packedVertices, &packedHeightMin, &packedHeightScale);
 
-	for (int x = 0; x < RENDER_DIST; x++)
-	{
-		for (int y = 0; y < RENDER_DIST; y++)
-		{
-			// Get noise values for biome type and terrain height (between -1 and 1)
-			// at the given x/y coordinate (2D position)
+	terrainVAO = createMeshVAO(packedVertices.data(), (int)(packedVertices.size() * sizeof(VAO::PackedVertexData)), chunkIndices);
 
-			// Generate noise at 3 different frequencies for additional variation
-			terrainVal = 1 * terrainNoise.GetNoise((float)x, (float)y)
-				+ 0.5 * terrainNoise.GetNoise(2 * (float)x, 2 * (float)y)
-				+ 0.25 * terrainNoise.GetNoise(4 * (float)x, 4 * (float)y);
+	// Grid layout needed to unpack the vertices
+	shaders->use();
+	shaders->setFloat("gridSize", (float)config.gridSize);
+	shaders->setFloat("verticeOffset", config.verticeOffset);
+	shaders->setFloat("startPos", config.getStartPos());
+	shaders->setInt("drawChunks", config.getDrawChunks());
+	shaders->setInt("drawChunkSize", DRAW_CHUNK_QUADS);
+	glUseProgram(0);
+}
 
-			// Generate noise and get absolute value (turbulence).
-			// This produces a simple noise map that gives the impression of
-			// winding pathways
-			pathVal = abs(pathNoise.GetNoise((float)x, (float)y));
+// Packs vertices into the compact 12 byte layout, with the heights stored
+// over the height range of the vertices (returned in heightMin/heightScale).
+// Uses no OpenGL, so it can run on a worker thread.
+void Terrain::packVertices(const VAO::VertexData* vertexData, int count, vector<VAO::PackedVertexData>* packedVertices, float* heightMin, float* heightScale)
+{
+	float minHeight = vertexData[0].vertices.y;
+	float maxHeight = vertexData[0].vertices.y;
 
-			modelsVal = modelNoise.GetNoise((float)x, (float)y); // Generate noise for model placement
+	for (int i = 1; i < count; i++)
+	{
+		minHeight = std::min(minHeight, vertexData[i].vertices.y);
+		maxHeight = std::max(maxHeight, vertexData[i].vertices.y);
+	}
 
-			// Set random height value (random noise) calculated before,
-			// to the vertex y value. 
-			// Divide by the sum of the 3 amplitudes to maintain values between 0-1
-			// Multiply by 2 for greater height diversity.
-			terrainVertices[terrainIndex].vertices.y = (terrainVal / (1 + 0.5 + 0.25)) * 2;
+	*heightMin = minHeight;
+	*heightScale = maxHeight > minHeight ? maxHeight - minHeight : 1.0f;
 
-			currBiome = getBiome(terrainVal, pathVal);
+	packVertices(vertexData, count, packedVertices, *heightMin, *heightScale);
+}
 
-			// Grass
-			if (currBiome == GRASS)
-			{
-				terrainVertices[terrainIndex].colours.r = 0.0f;
-				terrainVertices[terrainIndex].colours.g = 1.0f;
-				terrainVertices[terrainIndex].colours.b = 0.0f;
-				terrainVertices[terrainIndex].colours.a = 0.0f;
+// Packs vertices into the compact 12 byte layout, with the heights stored
+// over the given range. Uses no OpenGL, so it can run on a worker thread.
+void Terrain::packVertices(const VAO::VertexData* vertexData, int count, vector<VAO::PackedVertexData>* packedVertices, float heightMin, float heightScale)
+{
+	packedVertices->resize(count);
 
-				// Set grass/cacti here
-				if (getIfModelPlacement(currBiome, modelsVal))
-				{
-					grassModelPositions.push_back(vec3(terrainVertices[terrainIndex].vertices));
-				}
-			}
-			// Grass-desert transition
-			else if (currBiome == GRASS_DESERT)
-			{
-				terrainVertices[terrainIndex].colours.r = 0.5f;
-				terrainVertices[terrainIndex].colours.g = 1.0f;
-				terrainVertices[terrainIndex].colours.b = 0.0f;
-				terrainVertices[terrainIndex].colours.a = 0.0f;
-			}
-			// Water
-			else if (currBiome == OASIS)
-			{
-				terrainVertices[terrainIndex].colours.r = 0.0f;
-				terrainVertices[terrainIndex].colours.g = 0.0f;
-				terrainVertices[terrainIndex].colours.b = 1.0f;
-				terrainVertices[terrainIndex].colours.a = 0.0f;
-			}
-			// Desert-water transition
-			else if (currBiome == DESERT_OASIS)
-			{
-				terrainVertices[terrainIndex].colours.r = 1.0f;
-				terrainVertices[terrainIndex].colours.g = 0.0f;
-				terrainVertices[terrainIndex].colours.b = 0.5f;
-				terrainVertices[terrainIndex].colours.a = 0.0f;
+	int blockSize = GEN_BLOCK_BYTES / sizeof(VAO::VertexData);
+	int numBlocks = (count + blockSize - 1) / blockSize;
 
-				// Set grass/cacti here
-				if (getIfModelPlacement(currBiome, modelsVal))
-				{
-					oasisModelPositions.push_back(vec3(terrainVertices[terrainIndex].vertices));
-				}
-			}
-			// Sandy pathway
-			else if (currBiome == DESERT_PATH)
-			{
-				terrainVertices[terrainIndex].colours.r = 0.0f;
-				terrainVertices[terrainIndex].colours.g = 0.0f;
-				terrainVertices[terrainIndex].colours.b = 0.0f;
-				terrainVertices[terrainIndex].colours.a = 1.0f;
-			}
-			// Normal sand
-			else
-			{
-				terrainVertices[terrainIndex].colours.r = 1.0f;
-				terrainVertices[terrainIndex].colours.g = 0.0f;
-				terrainVertices[terrainIndex].colours.b = 0.0f;
-				terrainVertices[terrainIndex].colours.a = 0.0f;
-			}
+	ThreadPool::getShared()->parallelFor(numBlocks, [&](int block)
+	{
+		int end = std::min((block + 1) * blockSize, count);
 
-			terrainIndex++;
+		for (int i = block * blockSize; i < end; i++)
+		{
+			(*packedVertices)[i] = VAO::packVertex(vertexData[i], heightMin, heightScale);
 		}
-	}
+	});
 }
 
-// Calculate the texture coordinates for the terrain object.
-void Terrain::setTextureCoords()
+// Generates and binds all the textures needed for the terrain.
+void Terrain::setTextures()
 {
-	// Texture coords - bottom left
-	terrainVertices[BTM_LEFT].textures.x = 0.0f;
-	terrainVertices[BTM_LEFT].textures.y = 0.0f;
-
-	// Bottom right
-	terrainVertices[BTM_RIGHT].textures.x = 1.0f;
-	terrainVertices[BTM_RIGHT].textures.y = 0.0f;
+	for (int i = 0; i < NUM_TEXTURES; i++)
+	{
+		TerrainTexture* tex = new TerrainTexture(assetsFolder + TerrainTexture::texNames[i], (TerrainTexture::TerrainType)i, shaders);
+		tex->bindTexture();
 
-	// Top left
-	terrainVertices[TOP_LEFT].textures.x = 0.0f;
-	terrainVertices[TOP_LEFT].textures.y = 1.0f;
+		textures.push_back(tex);
+	}
+}
 
-	// Top right
-	terrainVertices[TOP_RIGHT].textures.x = 1.0f;
-	terrainVertices[TOP_RIGHT].textures.y = 1.0f;
+// Generate the indices joining the vertices of a mesh chunk into triangles.
+// Every chunk is stored the same way in the vertex buffer, so one pattern of
+// 16 bit indices is shared by all of them - a list of two triangles per
+// quad, reordered to reuse the GPU's post-transform vertex cache (see
+// MeshOptimiser) rather than swept row by row.
+//
+// With an adaptive mesh, each chunk gets its own triangles instead, fitted
+// to the current heights (see TerrainRTIN).
+void Terrain::generateIndices()
+{
+	const int chunkSide = DRAW_CHUNK_QUADS + 1;
 
-	int z = 0;
+	chunkIndices.clear();
+	chunkIndexStarts.clear();
 
-	// Scale 2D texture coordinates across the terrain between 0.0 and 1.0.
-	// Treat the terrain as one large quad
-	for (int x = 0; x < MAP_SIZE; x++)
+	if (isAdaptive())
 	{
-		div_t divResultX;
-		div_t divResultZ;
+		TerrainRTIN rtin(config, config.meshError);
+		rtin.buildMesh(this, &chunkIndices, &chunkIndexStarts);
 
-		divResultX = div(x, RENDER_DIST);
-		divResultZ = div(z, RENDER_DIST);
+		MeshOptimiser::CacheStats stats = { 0, 0, 0 };
 
-		if (x != BTM_LEFT
-			&& x != BTM_RIGHT
-			&& x != TOP_LEFT
-			&& x != TOP_RIGHT)
+		for (int chunk = 0; chunk + 1 < chunkIndexStarts.size(); chunk++)
 		{
-			terrainVertices[x].textures.x = (float)divResultX.rem / RENDER_DIST;
-			terrainVertices[x].textures.y = (float)divResultZ.rem / RENDER_DIST;
+			stats.add(MeshOptimiser::analyseVertexCache(chunkIndices.data() + chunkIndexStarts[chunk],
+				chunkIndexStarts[chunk + 1] - chunkIndexStarts[chunk], config.getDrawChunkVertices()));
 		}
 
-		// Move onward a row when at the end
-		if (divResultX.rem == RENDER_DIST - 1)
+		cout << "Adaptive mesh has " << chunkIndices.size() / 3 << " triangles (" << config.getTotalTriangles()
+			<< " in the full grid) within " << config.meshError << " height error, built in " << rtin.getBuildMs() << " ms - ACMR "
+			<< stats.getACMR() << ", ATVR " << stats.getATVR() << "\n";
+
+		return;
+	}
+
+	chunkIndices.reserve(config.getDrawChunkIndices());
+
+	for (int row = 0; row < DRAW_CHUNK_QUADS; row++)
+	{
+		// Splits each quad from top right to bottom left
+		for (int col = 0; col < DRAW_CHUNK_QUADS; col++)
 		{
-			z++;
+			GLushort topLeft = (GLushort)(row * chunkSide + col);
+			GLushort bottomLeft = (GLushort)(topLeft + chunkSide);
+
+			chunkIndices.push_back(topLeft);
+			chunkIndices.push_back(bottomLeft);
+			chunkIndices.push_back(topLeft + 1);
+
+			chunkIndices.push_back(topLeft + 1);
+			chunkIndices.push_back(bottomLeft);
+			chunkIndices.push_back(bottomLeft + 1);
 		}
 	}
+
+	MeshOptimiser::CacheStats before = MeshOptimiser::analyseVertexCache(chunkIndices.data(), (int)chunkIndices.size(), config.getDrawChunkVertices());
+
+	MeshOptimiser::optimiseVertexCache(chunkIndices.data(), (int)chunkIndices.size(), config.getDrawChunkVertices());
+
+	MeshOptimiser::CacheStats after = MeshOptimiser::analyseVertexCache(chunkIndices.data(), (int)chunkIndices.size(), config.getDrawChunkVertices());
+
+	cout << "Terrain chunk indices reordered for the vertex cache - ACMR " << before.getACMR() << " -> " << after.getACMR()
+		<< ", ATVR " << before.getATVR() << " -> " << after.getATVR() << "\n";
 }
 
-// Calculate the normal map for the terrain for BlinnPhong lighting.
-void Terrain::generateNormals()
+// Works out the vertex block and bounding box of each chunk of a world's
+// terrain mesh, in the same order createChunkVertices lays the chunks out.
+// Only reads the given world, so can run on a worker for a new one.
+void Terrain::createMeshChunks(const TerrainGenerator& world, const vector<int>& indexStarts, vector<MeshChunk>* chunks)
 {
-	for (int i = RENDER_DIST; i < MAP_SIZE; i++)
-	{
-		div_t divResult;
-		divResult = div(i, RENDER_DIST);
+	const int rowChunks = config.getRowChunks();
+	int baseVertex = 0;
 
-		// If not at the right edge
-		if (divResult.rem != RENDER_DIST - 1)
+	chunks->clear();
+
+	for (int chunkRow = 0; chunkRow < rowChunks; chunkRow += DRAW_CHUNK_QUADS)
+	{
+		for (int chunkCol = 0; chunkCol < rowChunks; chunkCol += DRAW_CHUNK_QUADS)
 		{
-			// Splits each coordinate into being part of a quad - 
-			// uses neighbouring vertices
-			vec3 topLeft = vec3(terrainVertices[i].vertices);
-			vec3 topRight = vec3(terrainVertices[i + 1].vertices);
+			int endRow = std::min(chunkRow + DRAW_CHUNK_QUADS, rowChunks);
+			int endCol = std::min(chunkCol + DRAW_CHUNK_QUADS, rowChunks);
+
+			// Only the triangles on the map are counted, not the empty ones
+			// past the edge
+			MeshChunk chunk;
+			chunk.baseVertex = baseVertex;
+			chunk.firstIndex = 0;
+			chunk.indexCount = config.getDrawChunkIndices();
+			chunk.triangles = (endRow - chunkRow) * (endCol - chunkCol) * CHUNK_TRIANGLES;
+
+			if (isAdaptive())
+			{
+				setAdaptiveRange(&chunk, indexStarts, (int)chunks->size());
+			}
 
-			vec3 btmLeft = vec3(terrainVertices[i - RENDER_DIST].vertices);
+			updateMeshChunkBox(world, (int)chunks->size(), &chunk);
+			chunks->push_back(chunk);
+
+			baseVertex += config.getDrawChunkVertices();
+		}
+	}
+}
 
-			// Multiply by -1 to ensure lighting doesn't appear reversed
-			vec3 normal = normalize(cross((topRight - topLeft), (btmLeft - topLeft)) * -1.0f);
+// Works out the box around every vertex used by a mesh chunk of a world,
+// including its far edges.
+void Terrain::updateMeshChunkBox(const TerrainGenerator& world, int chunk, MeshChunk* meshChunk)
+{
+	const int rowChunks = config.getRowChunks();
 
-			// Top left of quad
-			terrainVertices[i].normals.x += normal.x;
-			terrainVertices[i].normals.y += normal.y;
-			terrainVertices[i].normals.z += normal.z;
-			normalsCalc[i]++;
+	int chunkRow = (chunk / config.getDrawChunks()) * DRAW_CHUNK_QUADS;
+	int chunkCol = (chunk % config.getDrawChunks()) * DRAW_CHUNK_QUADS;
+	int endRow = std::min(chunkRow + DRAW_CHUNK_QUADS, rowChunks);
+	int endCol = std::min(chunkCol + DRAW_CHUNK_QUADS, rowChunks);
 
-			// Top right of quad
-			terrainVertices[i + 1].normals.x += normal.x;
-			terrainVertices[i + 1].normals.y += normal.y;
-			terrainVertices[i + 1].normals.z += normal.z;
-			normalsCalc[i + 1]++;
+	float minHeight = world.getMapHeight(chunkRow * config.gridSize + chunkCol);
+	float maxHeight = minHeight;
 
-			// Bottom left of quad
-			terrainVertices[i - RENDER_DIST].normals.x += normal.x;
-			terrainVertices[i - RENDER_DIST].normals.y += normal.y;
-			terrainVertices[i - RENDER_DIST].normals.z += normal.z;
-			normalsCalc[i - RENDER_DIST]++;
+	for (int row = chunkRow; row <= endRow; row++)
+	{
+		for (int col = chunkCol; col <= endCol; col++)
+		{
+			float height = world.getMapHeight(row * config.gridSize + col);
 
-			// Bottom right of quad
-			terrainVertices[(i - RENDER_DIST) + 1].normals.x += normal.x;
-			terrainVertices[(i - RENDER_DIST) + 1].normals.y += normal.y;
-			terrainVertices[(i - RENDER_DIST) + 1].normals.z += normal.z;
-			normalsCalc[(i - RENDER_DIST) + 1]++;
+			minHeight = std::min(minHeight, height);
+			maxHeight = std::max(maxHeight, height);
 		}
 	}
 
-	// Average normals where a vertice has multiple normal values
-	for (int i = RENDER_DIST; i < MAP_SIZE; i++)
+	// Half float heights can be up to 1/2048 of the height away from the
+	// unedited vertices still in the vertex buffer
+	if (world.hasHalfHeights())
 	{
-		terrainVertices[i].normals.x /= (float)normalsCalc[i];
-		terrainVertices[i].normals.y /= (float)normalsCalc[i];
-		terrainVertices[i].normals.z /= (float)normalsCalc[i];
+		float error = std::max(fabsf(minHeight), fabsf(maxHeight)) / 2048.0f;
+
+		minHeight -= error;
+		maxHeight += error;
 	}
+
+	meshChunk->boxMin = vec3(config.getStartPos() + chunkCol * config.verticeOffset, minHeight, config.getStartPos() - endRow * config.verticeOffset);
+	meshChunk->boxMax = vec3(config.getStartPos() + endCol * config.verticeOffset, maxHeight, config.getStartPos() - chunkRow * config.verticeOffset);
 }
 
-// Determines if a given position is at the boundary of the terrain.
-// Used to ensure the user cannot walk off the map
-bool Terrain::isAtEdge(vec3 pos)
+// Points a mesh chunk at its range of the adaptive mesh's indices.
+void Terrain::setAdaptiveRange(MeshChunk* chunk, const vector<int>& indexStarts, int index)
 {
-	bool atEdge = false;
-	vec3 terrainCoords;
-
-	terrainCoords.x = pos.x - TERRAIN_START.x;
-	terrainCoords.z = pos.z - TERRAIN_START.z;
-
-	if (terrainCoords.x < terrainVertices[BTM_LEFT].vertices.x
-		|| terrainCoords.x > terrainVertices[BTM_RIGHT].vertices.x
-		|| terrainCoords.z < terrainVertices[TOP_LEFT].vertices.z
-		|| terrainCoords.z > terrainVertices[BTM_LEFT].vertices.z)
-	{
-		atEdge = true;
-	}
-
-	return (atEdge);
+	chunk->firstIndex = indexStarts[index];
+	chunk->indexCount = indexStarts[index + 1] - indexStarts[index];
+	chunk->triangles = chunk->indexCount / 3;
 }
 
-// Returns the current biome at a given position (for audio purposes), 
-// as well as updating the given camera position's y coordinate with 
-// the y coordinate of the terrain at this x/z position.
-Terrain::Biome Terrain::offsetUserPos(vec3* pos)
+// Whether the mesh is drawn with adaptive triangles per chunk (see
+// TerrainRTIN) rather than the full grid.
+bool Terrain::isAdaptive()
 {
-	vec3 terrainCoords;
-	vec4 biomeColours;
+	return (config.meshError > 0.0f);
+}
 
-	Biome b;
+// Draws the chunks of the terrain mesh that are within the view frustum.
+// Each visible chunk draws the shared index pattern (or its own adaptive
+// triangles) from its own base vertex, all in one call.
+void Terrain::drawMeshChunks()
+{
+	Frustum frustum(terrainMVP);
 
-	// Terrain coordinates are the global camera coordinates, minus
-	// the terrain start values
-	terrainCoords.x = pos->x - TERRAIN_START.x;
-	terrainCoords.y = pos->y - TERRAIN_START.y;
-	terrainCoords.z = pos->z - TERRAIN_START.z;
+	visibleCounts.clear();
+	visibleOffsets.clear();
+	visibleBaseVertices.clear();
 
-	bool found = false;
-	int i = 0;
+	drawnTriangles = 0;
+	culledTriangles = 0;
 
-	// Get up vector at this terrain vertice
-	while (i < MAP_SIZE - 1 && !found)
+	for (int i = 0; i < meshChunks.size(); i++)
 	{
-		if ((terrainVertices[i].vertices.x == terrainCoords.x || (terrainCoords.x < terrainVertices[i].vertices.x + VERTICE_OFFSET && terrainCoords.x > terrainVertices[i].vertices.x - VERTICE_OFFSET))
-			&& (terrainVertices[i].vertices.z == terrainCoords.z || (terrainCoords.z < terrainVertices[i].vertices.z + VERTICE_OFFSET && terrainCoords.z > terrainVertices[i].vertices.z - VERTICE_OFFSET)))
-		{
-			terrainCoords.y = terrainVertices[i].vertices.y;
-			biomeColours = terrainVertices[i].colours;
+		const MeshChunk& chunk = meshChunks[i];
 
-			found = true;
+		if (!frustum.isBoxVisible(chunk.boxMin, chunk.boxMax))
+		{
+			culledTriangles += chunk.triangles;
+			continue;
 		}
 
-		i++;
+		drawnTriangles += chunk.triangles;
+
+		visibleCounts.push_back((GLsizei)chunk.indexCount);
+		visibleOffsets.push_back((const void*)((size_t)chunk.firstIndex * sizeof(GLushort)));
+		visibleBaseVertices.push_back(chunk.baseVertex);
 	}
 
-	// Uses terrain colour map to determine biome.
-	// - Grass-desert transition is considered grass
-	// - Desert path is considered desert
-	// - Desert-oasis transition is considered oasis
-	if (biomeColours.r == 1.0f || biomeColours.a == 1.0f)
+	if (!visibleCounts.empty())
 	{
-		b = DESERT;
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, visibleCounts.data(), GL_UNSIGNED_SHORT, visibleOffsets.data(),
+			(GLsizei)visibleCounts.size(), visibleBaseVertices.data());
 	}
-	else if (biomeColours.g == 1.0f)
+}
+
+// Edits the terrain within a radius of a (world space) position - raising,
+// lowering or flattening it to the height at the centre, or painting a biome.
+// The change fades out towards the edge of the brush, and strength is the
+// height moved (or fraction flattened) at the centre. Raised and lowered
+// vertices take the biome of their new height. Only the vertices under the
+// brush are changed, and their normals and GPU copies are updated before the
+// next draw.
+void Terrain::editTerrain(EditMode mode, vec3 pos, float radius, float strength, Biome paintBiome)
+{
+	// Streamed chunks are regenerated from the noise, so have nothing to edit
+	if (chunkManager != NULL)
 	{
-		b = GRASS;
+		return;
 	}
-	else
+
+	const int gridSize = config.gridSize;
+
+	float x = pos.x - TERRAIN_START.x;
+	float z = pos.z - TERRAIN_START.z;
+
+	// Brush centre and size on the grid
+	float centreCol = (x - config.getStartPos()) / config.verticeOffset;
+	float centreRow = (config.getStartPos() - z) / config.verticeOffset;
+	float cells = radius / config.verticeOffset;
+
+	EditRect rect;
+	rect.firstRow = std::max((int)ceilf(centreRow - cells), 0);
+	rect.endRow = std::min((int)floorf(centreRow + cells) + 1, gridSize);
+	rect.firstCol = std::max((int)ceilf(centreCol - cells), 0);
+	rect.endCol = std::min((int)floorf(centreCol + cells) + 1, gridSize);
+
+	if (rect.firstRow >= rect.endRow || rect.firstCol >= rect.endCol)
 	{
-		b = OASIS;
+		return;
 	}
 
-	pos->y = terrainCoords.y;
+	float flattenHeight = heightField->getHeight(x, z);
+
+	// Path noise, to pick the biome of vertices at their new height
+	TerrainNoise noise(config);
+
+	for (int row = rect.firstRow; row < rect.endRow; row++)
+	{
+		for (int col = rect.firstCol; col < rect.endCol; col++)
+		{
+			float distance = sqrtf((row - centreRow) * (row - centreRow) + (col - centreCol) * (col - centreCol)) / cells;
+
+			if (distance >= 1.0f)
+			{
+				continue;
+			}
+
+			// Smooth fall off from the centre to the edge
+			float weight = 1.0f - distance;
+			weight = weight * weight * (3.0f - 2.0f * weight);
+
+			int i = row * gridSize + col;
+			float height = getMapHeight(i);
+			unsigned char biome = biomeMap[i];
 
-	return (b);
+			switch (mode)
+			{
+			case EDIT_RAISE:
+				height += strength * weight;
+				break;
+			case EDIT_LOWER:
+				height -= strength * weight;
+				break;
+			case EDIT_FLATTEN:
+				height += (flattenHeight - height) * std::min(strength * weight, 1.0f);
+				break;
+			case EDIT_PAINT:
+				biomeMap[i] = (unsigned char)paintBiome;
+				break;
+			}
+
+			// Heights are the summed height noise scaled by 2 / 1.75 (see
+			// TerrainNoise), so the biome can be worked out from the height
+			if (mode != EDIT_PAINT)
+			{
+				setMapHeight(i, height);
+
+				float terrainNoise = getMapHeight(i) * (1.0f + 0.5f + 0.25f) / 2.0f;
+
+				biomeMap[i] = (unsigned char)getBiome(terrainNoise, noise.getSample((float)row, (float)col).path);
+			}
+
+			if (biomeMap[i] != biome)
+			{
+				biomesEdited = true;
+			}
+
+			if (isMeshResident())
+			{
+				terrainVertices[i].vertices.y = getMapHeight(i);
+				terrainVertices[i].colours = getBiomeColour((Biome)biomeMap[i]);
+			}
+		}
+	}
+
+	// Normals also change for the vertices next to the edited ones
+	rect.firstRow = std::max(rect.firstRow - 1, 0);
+	rect.endRow = std::min(rect.endRow + 1, gridSize);
+	rect.firstCol = std::max(rect.firstCol - 1, 0);
+	rect.endCol = std::min(rect.endCol + 1, gridSize);
+
+	dirtyRects.push_back(rect);
+}
+
+// Updates the normals, culling boxes and GPU vertices of every area edited
+// since the last draw.
+void Terrain::applyEdits()
+{
+	updateMapRebuild();
+
+	for (int i = 0; i < dirtyRects.size(); i++)
+	{
+		const EditRect& rect = dirtyRects[i];
+
+		// Released vertices get their normals when they are rebuilt
+		if (isMeshResident())
+		{
+			generateNormals(rect.firstRow, rect.endRow, rect.firstCol, rect.endCol);
+		}
+
+		if (terrainVAO != NULL)
+		{
+			uploadVertices(rect);
+		}
+	}
+
+	if (terrainVAO != NULL && isAdaptive() && !dirtyRects.empty())
+	{
+		rebuildAdaptiveChunks();
+	}
+
+	dirtyRects.clear();
+}
+
+// Keeps the regions and water distances up to date with edited biomes,
+// without going over the whole map on the render thread. A rebuild is
+// started once a frame passes with no edits, so a stroke is only worked over
+// once. Its results are swapped in on the first frame after the worker is
+// done - unless the world has been regenerated since, when they are dropped.
+void Terrain::updateMapRebuild()
+{
+	if (mapRebuild != NULL)
+	{
+		{
+			lock_guard<mutex> lock(mapRebuild->lock);
+
+			if (!mapRebuild->done)
+			{
+				return;
+			}
+		}
+
+		if (mapRebuild->worldVersion == worldVersion)
+		{
+			std::swap(regions, mapRebuild->regions);
+			waterDistanceMap.swap(mapRebuild->waterDistanceMap);
+		}
+
+		delete mapRebuild->regions;
+		delete mapRebuild;
+		mapRebuild = NULL;
+	}
+
+	if (!biomesEdited || !dirtyRects.empty())
+	{
+		return;
+	}
+
+	biomesEdited = false;
+
+	MapRebuild* rebuild = new MapRebuild();
+	rebuild->biomeMap = biomeMap;
+	rebuild->heightMap = getFloatHeights(&rebuild->heightMap);	// Unpacked straight into the copy if the heights are halves
+	rebuild->regions = NULL;
+	rebuild->worldVersion = worldVersion;
+	rebuild->done = false;
+
+	mapRebuild = rebuild;
+
+	TerrainConfig cfg = config;
+
+	ThreadPool::getShared()->submit([rebuild, cfg]()
+	{
+		rebuild->regions = new TerrainRegions(cfg, rebuild->biomeMap, rebuild->heightMap);
+
+		TerrainDistance distance(cfg);
+		distance.build(rebuild->biomeMap, (unsigned char)OASIS, &rebuild->waterDistanceMap);
+
+		// Signalled under the lock - the render thread frees rebuild as soon
+		// as it sees done
+		{
+			lock_guard<mutex> lock(rebuild->lock);
+			rebuild->done = true;
+			rebuild->doneSignal.notify_all();
+		}
+	});
+}
+
+// Fits new adaptive triangles to every chunk edited since the last draw, in
+// parallel, and replaces the index buffer. The other chunks' triangles are
+// copied across as they were.
+void Terrain::rebuildAdaptiveChunks()
+{
+	const int chunks = config.getDrawChunks();
+	const int numChunks = chunks * chunks;
+
+	vector<bool> edited(numChunks, false);
+	vector<int> editedChunks;
+
+	for (int i = 0; i < dirtyRects.size(); i++)
+	{
+		const EditRect& rect = dirtyRects[i];
+
+		// The same chunks as uploadVertices - edge vertices are in the chunks
+		// either side of them
+		int firstChunkRow = std::min(std::max(rect.firstRow - 1, 0) / DRAW_CHUNK_QUADS, chunks - 1);
+		int lastChunkRow = std::min((rect.endRow - 1) / DRAW_CHUNK_QUADS, chunks - 1);
+		int firstChunkCol = std::min(std::max(rect.firstCol - 1, 0) / DRAW_CHUNK_QUADS, chunks - 1);
+		int lastChunkCol = std::min((rect.endCol - 1) / DRAW_CHUNK_QUADS, chunks - 1);
+
+		for (int chunkRow = firstChunkRow; chunkRow <= lastChunkRow; chunkRow++)
+		{
+			for (int chunkCol = firstChunkCol; chunkCol <= lastChunkCol; chunkCol++)
+			{
+				int chunk = chunkRow * chunks + chunkCol;
+
+				if (!edited[chunk])
+				{
+					edited[chunk] = true;
+					editedChunks.push_back(chunk);
+				}
+			}
+		}
+	}
+
+	TerrainRTIN rtin(config, config.meshError);
+	vector<vector<GLushort>> rebuilt(editedChunks.size());
+
+	ThreadPool::getShared()->parallelFor((int)editedChunks.size(), [&](int i)
+	{
+		rtin.buildChunk(this, editedChunks[i], &rebuilt[i]);
+	});
+
+	vector<GLushort> indices;
+	vector<int> starts(numChunks + 1);
+
+	indices.reserve(chunkIndices.size());
+	starts[0] = 0;
+
+	for (int chunk = 0, next = 0; chunk < numChunks; chunk++)
+	{
+		if (edited[chunk])
+		{
+			indices.insert(indices.end(), rebuilt[next].begin(), rebuilt[next].end());
+			next++;
+		}
+		else
+		{
+			indices.insert(indices.end(), chunkIndices.begin() + chunkIndexStarts[chunk], chunkIndices.begin() + chunkIndexStarts[chunk + 1]);
+		}
+
+		starts[chunk + 1] = (int)indices.size();
+	}
+
+	chunkIndices.swap(indices);
+	chunkIndexStarts.swap(starts);
+
+	for (int chunk = 0; chunk < numChunks; chunk++)
+	{
+		setAdaptiveRange(&meshChunks[chunk], chunkIndexStarts, chunk);
+	}
+
+	terrainVAO->bind();
+	terrainVAO->replaceIndices(chunkIndices.data(), (int)(chunkIndices.size() * sizeof(GLushort)));
+	terrainVAO->unbind();
+}
+
+// Copies the edited vertices into the vertex buffer, and updates the culling
+// boxes of the chunks they are in. Each chunk holds its vertices row by row,
+// so the edited rows of each chunk are a single range of the buffer.
+void Terrain::uploadVertices(const EditRect& rect)
+{
+	const int chunks = config.getDrawChunks();
+	const int chunkSide = DRAW_CHUNK_QUADS + 1;
+
+	// Edge vertices are stored in the chunks either side of them
+	int firstChunkRow = std::min(std::max(rect.firstRow - 1, 0) / DRAW_CHUNK_QUADS, chunks - 1);
+	int lastChunkRow = std::min((rect.endRow - 1) / DRAW_CHUNK_QUADS, chunks - 1);
+	int firstChunkCol = std::min(std::max(rect.firstCol - 1, 0) / DRAW_CHUNK_QUADS, chunks - 1);
+	int lastChunkCol = std::min((rect.endCol - 1) / DRAW_CHUNK_QUADS, chunks - 1);
+
+	vector<VAO::VertexData> vertices;
+	vector<VAO::PackedVertexData> packedVertices;
+
+	if (config.packVertices)
+	{
+		widenPackedRange(rect);
+	}
+
+	terrainVAO->bind();
+
+	for (int chunkRow = firstChunkRow; chunkRow <= lastChunkRow; chunkRow++)
+	{
+		for (int chunkCol = firstChunkCol; chunkCol <= lastChunkCol; chunkCol++)
+		{
+			int chunk = chunkRow * chunks + chunkCol;
+
+			// Rows of the chunk that were edited - to the end of the chunk if
+			// the edit reaches the last row of the map, for the repeated rows
+			int firstRow = std::max(rect.firstRow - chunkRow * DRAW_CHUNK_QUADS, 0);
+			int endRow = rect.endRow == config.gridSize ? chunkSide : std::min(rect.endRow - chunkRow * DRAW_CHUNK_QUADS, chunkSide);
+
+			if (firstRow >= endRow)
+			{
+				continue;
+			}
+
+			vertices.resize((endRow - firstRow) * chunkSide);
+
+			for (int row = firstRow; row < endRow; row++)
+			{
+				for (int col = 0; col < chunkSide; col++)
+				{
+					vertices[(row - firstRow) * chunkSide + col] = getChunkVertex(chunk, row, col);
+				}
+			}
+
+			int firstVertex = meshChunks[chunk].baseVertex + firstRow * chunkSide;
+
+			if (config.packVertices)
+			{
+				packedVertices.resize(vertices.size());
+
+				for (int v = 0; v < vertices.size(); v++)
+				{
+					packedVertices[v] = VAO::packVertex(vertices[v], packedHeightMin, packedHeightScale);
+				}
+
+				terrainVAO->updateVertices(packedVertices.data(), firstVertex * (int)sizeof(VAO::PackedVertexData),
+					(int)(packedVertices.size() * sizeof(VAO::PackedVertexData)));
+			}
+			else
+			{
+				terrainVAO->updateVertices(vertices.data(), firstVertex * (int)sizeof(VAO::VertexData),
+					(int)(vertices.size() * sizeof(VAO::VertexData)));
+			}
+
+			updateMeshChunkBox(*this, chunk, &meshChunks[chunk]);
+		}
+	}
+
+	terrainVAO->unbind();
+}
+
+// Packed heights are clamped to the range they are stored over, so when an
+// edit raises or lowers the terrain outside that range, the range is widened
+// (with some headroom, so a long stroke doesn't do this every frame) and the
+// whole vertex buffer is packed again.
+void Terrain::widenPackedRange(const EditRect& rect)
+{
+	float minHeight = packedHeightMin;
+	float maxHeight = packedHeightMin + packedHeightScale;
+
+	for (int row = rect.firstRow; row < rect.endRow; row++)
+	{
+		for (int col = rect.firstCol; col < rect.endCol; col++)
+		{
+			float height = world.getMapHeight(row * config.gridSize + col);
+
+			minHeight = std::min(minHeight, height);
+			maxHeight = std::max(maxHeight, height);
+		}
+	}
+
+	if (minHeight >= packedHeightMin && maxHeight <= packedHeightMin + packedHeightScale)
+	{
+		return;
+	}
+
+	float headroom = (maxHeight - minHeight) * PACKED_HEIGHT_HEADROOM;
+
+	if (minHeight < packedHeightMin)
+	{
+		minHeight -= headroom;
+	}
+
+	if (maxHeight > packedHeightMin + packedHeightScale)
+	{
+		maxHeight += headroom;
+	}
+
+	packedHeightMin = minHeight;
+	packedHeightScale = maxHeight - minHeight;
+
+	vector<VAO::VertexData> chunkVertices;
+	vector<VAO::PackedVertexData> packedVertices;
+
+	createChunkVertices(&chunkVertices);
+	packVertices(chunkVertices.data(), (int)chunkVertices.size(), &packedVertices, packedHeightMin, packedHeightScale);
+
+	terrainVAO->bind();
+	terrainVAO->updateVertices(packedVertices.data(), 0, (int)(packedVertices.size() * sizeof(VAO::PackedVertexData)));
+	terrainVAO->unbind();
+
+	cout << "Packed terrain height range widened to " << packedHeightMin << " - " << maxHeight << " by an edit\n";
+}
+
+// Starts building a new world from the given seed to replace this one. It is
+// generated on the thread pool while this world carries on being drawn and
+// edited, then uploaded over the next few frames and swapped in (see
+// updateRegeneration). Edits made to this world in the meantime are lost.
+void Terrain::regenerate(unsigned int seed)
+{
+	if (nextWorld != NULL)
+	{
+		cout << "[!] A new world is already being generated\n";
+		return;
+	}
+
+	// A streamed world is only the chunks around the camera, so starts again
+	// from the new seed straight away
+	if (chunkManager != NULL)
+	{
+		config.worldSeed = seed;
+
+		delete chunkManager;
+		chunkManager = new ChunkManager(config);
+
+		worldVersion++;
+
+		cout << "Streaming world " << seed << "\n";
+		return;
+	}
+
+	TerrainConfig nextConfig = config;
+	nextConfig.worldSeed = seed;
+
+	nextWorld = new NextWorld();
+	nextWorld->generator = new TerrainGenerator(nextConfig);
+	nextWorld->regions = NULL;
+	nextWorld->packedHeightMin = 0.0f;
+	nextWorld->packedHeightScale = 1.0f;
+	nextWorld->useLOD = terrainLOD != NULL;
+	nextWorld->screenHeight = lodScreenHeight;
+	nextWorld->lod = NULL;
+	nextWorld->displacement = NULL;
+	nextWorld->generated = false;
+	nextWorld->vao = NULL;
+	nextWorld->uploadedBytes = 0;
+	nextWorld->fence = NULL;
+	nextWorld->startTime = chrono::steady_clock::now();
+	nextWorld->generateMs = 0.0;
+	nextWorld->uploadFrames = 0;
+	nextWorld->longestFrameMs = 0.0;
+
+	cout << "Generating world " << seed << "\n";
+
+	NextWorld* next = nextWorld;
+
+	ThreadPool::getShared()->submit([this, next]()
+	{
+		generateNextWorld(next);
+	});
+}
+
+// Whether a new world is being generated or uploaded.
+bool Terrain::isRegenerating()
+{
+	return (nextWorld != NULL);
+}
+
+// Returns how many times the world has been regenerated - used by anything
+// holding a copy of the world's data (e.g. model positions) to know when to
+// fetch it again.
+int Terrain::getWorldVersion()
+{
+	return (worldVersion);
+}
+
+// Generates the next world and works out everything swapWorlds needs - the
+// vertices laid out for upload as buildTerrain does, the chunk boxes, and the
+// LOD or displacement data with their textures ready to upload. Runs on a
+// worker thread - no GL calls.
+void Terrain::generateNextWorld(NextWorld* next)
+{
+	auto start = chrono::steady_clock::now();
+
+	// GPU displacement only needs the heights, biomes and model positions
+	next->generator->generate(config.displaceOnGPU);
+
+	const vector<float>& heights = next->generator->getHeightMap();
+	const vector<unsigned char>& biomes = next->generator->getBiomeMap();
+
+	next->regions = new TerrainRegions(config, biomes, heights);
+
+	if (config.displaceOnGPU)
+	{
+		next->displacement = new TerrainDisplacement(config, heights, biomes, shaders);
+	}
+	else
+	{
+		next->generator->createChunkVertices(&next->vertices);
+
+		if (isAdaptive())
+		{
+			TerrainRTIN rtin(config, config.meshError);
+			rtin.buildMesh(next->generator, &next->indices, &next->indexStarts);
+		}
+
+		createMeshChunks(*next->generator, next->indexStarts, &next->meshChunks);
+
+		if (config.packVertices)
+		{
+			packVertices(next->vertices.data(), (int)next->vertices.size(), &next->packedVertices, &next->packedHeightMin, &next->packedHeightScale);
+			vector<VAO::VertexData>().swap(next->vertices);
+		}
+	}
+
+	// Made from the float heights, before they may be halved below
+	if (next->useLOD)
+	{
+		next->lod = new TerrainLOD(config, heights, biomes, next->screenHeight, shaders);
+	}
+
+	if (!config.keepMesh)
+	{
+		next->generator->releaseVertices(config.halfHeights);
+	}
+
+	next->generateMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	// Signalled under the lock - once generated is seen, the render thread
+	// may free next (and its condition variable) straight away
+	{
+		lock_guard<mutex> lock(next->lock);
+		next->generated = true;
+		next->generatedSignal.notify_all();
+	}
+}
+
+// Moves a regenerated world along by one step each frame, never waiting on
+// the worker or the GPU. Once it has been generated, its vertex buffer and
+// then its LOD/displacement textures are filled, REGEN_UPLOAD_BYTES_PER_FRAME
+// at a time between them, then a fence is placed after the last upload. The
+// worlds are swapped on the first frame the fence has been reached, so the
+// new world is never drawn from a buffer the GPU is still copying.
+void Terrain::updateRegeneration()
+{
+	if (nextWorld == NULL)
+	{
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(nextWorld->lock);
+
+		if (!nextWorld->generated)
+		{
+			return;
+		}
+	}
+
+	auto start = chrono::steady_clock::now();
+
+	bool ready = false;
+
+	if (nextWorld->fence == NULL)
+	{
+		int budget = REGEN_UPLOAD_BYTES_PER_FRAME;
+		bool uploaded = true;
+
+		if (!config.displaceOnGPU)
+		{
+			const char* vertexData = config.packVertices ? (const char*)nextWorld->packedVertices.data() : (const char*)nextWorld->vertices.data();
+			int size = config.packVertices ? (int)(nextWorld->packedVertices.size() * sizeof(VAO::PackedVertexData))
+				: (int)(nextWorld->vertices.size() * sizeof(VAO::VertexData));
+
+			if (nextWorld->vao == NULL && isAdaptive())
+			{
+				// Fitted to the new world's heights by the worker
+				nextWorld->vao = createMeshVAO(NULL, size, nextWorld->indices);
+			}
+			else if (nextWorld->vao == NULL)
+			{
+				// The index pattern is freed after the first upload
+				if (chunkIndices.empty())
+				{
+					generateIndices();
+				}
+
+				nextWorld->vao = createMeshVAO(NULL, size, chunkIndices);
+
+				if (!config.keepMesh)
+				{
+					vector<GLushort>().swap(chunkIndices);
+				}
+			}
+
+			int bytes = std::min(budget, size - nextWorld->uploadedBytes);
+
+			if (bytes > 0)
+			{
+				nextWorld->vao->updateVertices(vertexData + nextWorld->uploadedBytes, nextWorld->uploadedBytes, bytes);
+			}
+
+			nextWorld->uploadedBytes += bytes;
+			budget -= bytes;
+
+			uploaded = nextWorld->uploadedBytes == size;
+		}
+
+		// Then the textures, in what is left of this frame's budget
+		if (uploaded && nextWorld->displacement != NULL)
+		{
+			budget -= nextWorld->displacement->uploadTextures(budget);
+			uploaded = nextWorld->displacement->isUploaded();
+		}
+
+		if (uploaded && nextWorld->lod != NULL)
+		{
+			budget -= nextWorld->lod->uploadTextures(budget);
+			uploaded = nextWorld->lod->isUploaded();
+		}
+
+		nextWorld->uploadFrames++;
+
+		if (uploaded)
+		{
+			nextWorld->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+	}
+	else
+	{
+		// Only checks the fence (flushing it to the GPU) - does not wait
+		GLenum status = glClientWaitSync(nextWorld->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+		{
+			glDeleteSync(nextWorld->fence);
+			nextWorld->fence = NULL;
+
+			ready = true;
+		}
+	}
+
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	nextWorld->longestFrameMs = std::max(nextWorld->longestFrameMs, ms);
+
+	if (ready)
+	{
+		swapWorlds();
+	}
+}
+
+// Swaps the regenerated world in for the current one. The generated data,
+// chunk boxes and uploaded LOD/displacement textures are all swapped, not
+// copied or rebuilt, and the old world is freed on the thread pool, so this
+// only moves the bird song to the new world.
+void Terrain::swapWorlds()
+{
+	auto start = chrono::steady_clock::now();
+
+	NextWorld* next = nextWorld;
+	nextWorld = NULL;
+
+	// Afterwards, next holds the old world
+	std::swap(static_cast<TerrainGenerator&>(*this), *next->generator);
+	std::swap(terrainVAO, next->vao);
+	std::swap(regions, next->regions);
+
+	if (isAdaptive())
+	{
+		chunkIndices.swap(next->indices);
+		chunkIndexStarts.swap(next->indexStarts);
+	}
+
+	packedHeightMin = next->packedHeightMin;
+	packedHeightScale = next->packedHeightScale;
+
+	// Edits to the old world that were not drawn yet
+	dirtyRects.clear();
+	biomesEdited = false;
+
+	meshChunks.swap(next->meshChunks);
+	std::swap(terrainDisplacement, next->displacement);
+	std::swap(terrainLOD, next->lod);
+
+	// The window may have been resized since the worker picked the LOD ranges
+	if (terrainLOD != NULL)
+	{
+		terrainLOD->setScreenHeight(lodScreenHeight);
+	}
+
+	// Move the bird song to a tree in the new world
+	if (sound)
+	{
+		sound->stop();
+		sound->drop();
+		sound = NULL;
+	}
+
+	soundTreeModel = vec3(0.0f);
+	setSoundTree();
+
+	worldVersion++;
+
+	// The GL objects go now (the driver keeps them until frames using them
+	// are done), the old world's memory is freed off the render thread
+	delete next->vao;
+	delete next->lod;
+	delete next->displacement;
+	next->vao = NULL;
+	next->lod = NULL;
+	next->displacement = NULL;
+
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	double totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - next->startTime).count();
+
+	cout << "Swapped in world " << config.worldSeed << " after " << totalMs << " ms - generated in " << next->generateMs
+		<< " ms on the thread pool, uploaded over " << next->uploadFrames << " frames. Longest frame step " << std::max(next->longestFrameMs, ms)
+		<< " ms, swap " << ms << " ms\n";
+
+	ThreadPool::getShared()->submit([next]()
+	{
+		delete next->generator;
+		delete next->regions;
+		delete next;
+	});
+}
+
+// Returns how far a world space position is from the nearest oasis water.
+float Terrain::getWaterDistance(vec3 pos)
+{
+	// Streamed worlds have no water distances
+	if (heightField == NULL)
+	{
+		return (numeric_limits<float>::infinity());
+	}
+
+	return (heightField->getWaterDistance(pos.x - TERRAIN_START.x, pos.z - TERRAIN_START.z));
+}
+
+// Returns the oases and grassland patches of the current world.
+const TerrainRegions* Terrain::getRegions()
+{
+	return (regions);
+}
+
+// Determines if a given position is at the boundary of the terrain.
+// Used to ensure the user cannot walk off the map
+bool Terrain::isAtEdge(vec3 pos)
+{
+	// A streamed world has no edge
+	if (chunkManager != NULL)
+	{
+		return (false);
+	}
+
+	return (!heightField->isInside(pos.x - TERRAIN_START.x, pos.z - TERRAIN_START.z));
+}
+
+// Samples the ground at many world space x/z positions at once - the height
+// (in world space), surface normal and biome under each. Any of the outputs
+// can be NULL. For placing many objects on the terrain each frame, this is
+// much faster than a query per position (see HeightField::getSamples).
+void Terrain::getGroundSamples(const float* x, const float* z, int count, float* heights, vec3* normals, Biome* biomes)
+{
+	float localX[GROUND_SAMPLE_BLOCK];
+	float localZ[GROUND_SAMPLE_BLOCK];
+
+	for (int first = 0; first < count; first += GROUND_SAMPLE_BLOCK)
+	{
+		int n = std::min(GROUND_SAMPLE_BLOCK, count - first);
+
+		for (int i = 0; i < n; i++)
+		{
+			localX[i] = x[first + i] - TERRAIN_START.x;
+			localZ[i] = z[first + i] - TERRAIN_START.z;
+		}
+
+		// A streamed world is sampled from its noise, as it has no maps
+		if (chunkManager != NULL)
+		{
+			chunkManager->getSamples(localX, localZ, n, heights != NULL ? heights + first : NULL,
+				normals != NULL ? normals + first : NULL, biomes != NULL ? biomes + first : NULL);
+		}
+		else
+		{
+			heightField->getSamples(localX, localZ, n, heights != NULL ? heights + first : NULL,
+				normals != NULL ? normals + first : NULL, biomes != NULL ? biomes + first : NULL);
+		}
+
+		if (heights != NULL)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				heights[first + i] += TERRAIN_START.y;
+			}
+		}
+	}
 }
\ No newline at end of file
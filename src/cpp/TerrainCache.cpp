@@ -0,0 +1,296 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "..\h\TerrainCache.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+
+// Works out the cache file for this set of terrain settings.
+TerrainCache::TerrainCache(const TerrainConfig& cfg)
+{
+	config = cfg;
+
+	mappedData = NULL;
+	mappedSize = 0;
+
+	// Name the file after a hash (FNV-1a) of the settings, so each
+	// different terrain gets its own file
+	Header key = makeHeader();
+	const unsigned char* keyBytes = (const unsigned char*)&key.gridSize;
+	const size_t keySize = (const char*)&key.vertexOffset - (const char*)&key.gridSize;
+
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < keySize; i++)
+	{
+		hash ^= keyBytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "terrain_%016llx.cache", (unsigned long long)hash);
+
+	fileName = string(TERRAIN_CACHE_FOLDER) + name;
+}
+
+TerrainCache::~TerrainCache()
+{
+	unmap();
+}
+
+// Path of the cache file for these settings
+const string& TerrainCache::getFileName()
+{
+	return (fileName);
+}
+
+// Fills in a header for the current settings, with no data blocks.
+TerrainCache::Header TerrainCache::makeHeader()
+{
+	Header header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TERRAIN_CACHE_MAGIC, sizeof(header.magic));
+
+	header.version			= TERRAIN_CACHE_VERSION;
+	header.headerSize		= sizeof(Header);
+	header.vertexStride		= sizeof(VAO::VertexData);
+
+	header.gridSize			= config.gridSize;
+	header.verticeOffset	= config.verticeOffset;
+	header.terrainFrequency	= config.terrainFrequency;
+	header.pathFrequency	= config.pathFrequency;
+	header.modelFrequency	= config.modelFrequency;
+	header.worldSeed		= config.worldSeed;
+	header.erosionIterations	= config.erosionIterations;
+	header.erosionSeed		= config.erosionSeed;
+
+	return (header);
+}
+
+// Maps the cache file into memory. Returns false if there is no file
+// for these settings, or if it is from another version or incomplete.
+bool TerrainCache::load()
+{
+	unmap();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return (false);
+	}
+
+	LARGE_INTEGER size;
+
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		if (mapping != NULL)
+		{
+			mappedData = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			mappedSize = (size_t)size.QuadPart;
+
+			// The view keeps the file open until it is unmapped
+			CloseHandle(mapping);
+		}
+	}
+
+	CloseHandle(file);
+#else
+	int file = open(fileName.c_str(), O_RDONLY);
+
+	if (file < 0)
+	{
+		return (false);
+	}
+
+	struct stat info;
+
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+		if (data != MAP_FAILED)
+		{
+			mappedData = (const char*)data;
+			mappedSize = (size_t)info.st_size;
+		}
+	}
+
+	close(file);
+#endif
+
+	if (mappedData != NULL && !isValid())
+	{
+		cout << "[!] Ignoring out of date terrain cache " << fileName << "\n";
+		unmap();
+	}
+
+	return (mappedData != NULL);
+}
+
+// Checks the mapped file was written for these settings by this version,
+// and that every data block lies within the file.
+bool TerrainCache::isValid()
+{
+	if (mappedSize < sizeof(Header))
+	{
+		return (false);
+	}
+
+	const Header* header = getHeader();
+	Header expected = makeHeader();
+
+	// Everything before the blocks must match - format and settings
+	if (memcmp(header, &expected, offsetof(Header, vertexOffset)) != 0 || header->fileSize != mappedSize)
+	{
+		return (false);
+	}
+
+	if (header->vertexCount != (uint64_t)config.getDrawVertexCount())
+	{
+		return (false);
+	}
+
+	const uint64_t mapSize = (uint64_t)config.getMapSize();
+
+	return (header->vertexOffset + header->vertexCount * sizeof(VAO::VertexData) <= mappedSize
+		&& header->grassOffset + header->grassCount * sizeof(vec3) <= mappedSize
+		&& header->oasisOffset + header->oasisCount * sizeof(vec3) <= mappedSize
+		&& header->heightMapOffset + mapSize * sizeof(float) <= mappedSize
+		&& header->biomeMapOffset + mapSize <= mappedSize);
+}
+
+// Writes a generated terrain to the cache file for these settings.
+bool TerrainCache::save(const vector<VAO::VertexData>& vertices,
+	const vector<vec3>& grassPositions, const vector<vec3>& oasisPositions,
+	const vector<float>& heightMap, const vector<unsigned char>& biomeMap)
+{
+	// Release the file in case an old version of it is mapped
+	unmap();
+
+#ifdef _WIN32
+	_mkdir(TERRAIN_CACHE_FOLDER);
+#else
+	mkdir(TERRAIN_CACHE_FOLDER, 0755);
+#endif
+
+	Header header = makeHeader();
+
+	const void* blocks[] = { vertices.data(), grassPositions.data(), oasisPositions.data(),
+		heightMap.data(), biomeMap.data() };
+	uint64_t sizes[] = { vertices.size() * sizeof(VAO::VertexData),
+		grassPositions.size() * sizeof(vec3), oasisPositions.size() * sizeof(vec3),
+		heightMap.size() * sizeof(float), biomeMap.size() };
+	uint64_t* offsets[] = { &header.vertexOffset, &header.grassOffset, &header.oasisOffset,
+		&header.heightMapOffset, &header.biomeMapOffset };
+	const int numBlocks = sizeof(blocks) / sizeof(blocks[0]);
+
+	header.vertexCount	= vertices.size();
+	header.grassCount	= grassPositions.size();
+	header.oasisCount	= oasisPositions.size();
+
+	// Lay the blocks out one after another, each starting on an aligned offset
+	uint64_t offset = sizeof(Header);
+
+	for (int i = 0; i < numBlocks; i++)
+	{
+		offset = (offset + TERRAIN_CACHE_ALIGN - 1) / TERRAIN_CACHE_ALIGN * TERRAIN_CACHE_ALIGN;
+		*offsets[i] = offset;
+		offset += sizes[i];
+	}
+
+	header.fileSize = offset;
+
+	ofstream file(fileName, ios::binary | ios::trunc);
+
+	if (!file)
+	{
+		cout << "[!] Could not create terrain cache " << fileName << "\n";
+		return (false);
+	}
+
+	const char padding[TERRAIN_CACHE_ALIGN] = {};
+	uint64_t written = sizeof(Header);
+
+	file.write((const char*)&header, sizeof(Header));
+
+	for (int i = 0; i < numBlocks; i++)
+	{
+		file.write(padding, (streamsize)(*offsets[i] - written));
+		file.write((const char*)blocks[i], (streamsize)sizes[i]);
+
+		written = *offsets[i] + sizes[i];
+	}
+
+	if (!file)
+	{
+		cout << "[!] Could not write terrain cache " << fileName << "\n";
+		return (false);
+	}
+
+	return (true);
+}
+
+// Unmaps the file, if loaded
+void TerrainCache::unmap()
+{
+	if (mappedData != NULL)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mappedData);
+#else
+		munmap((void*)mappedData, mappedSize);
+#endif
+	}
+
+	mappedData = NULL;
+	mappedSize = 0;
+}
+
+// Pointers into the loaded file. Only valid while the cache is loaded.
+const TerrainCache::Header* TerrainCache::getHeader()
+{
+	return ((const Header*)mappedData);
+}
+
+const VAO::VertexData* TerrainCache::getVertices()
+{
+	return ((const VAO::VertexData*)(mappedData + getHeader()->vertexOffset));
+}
+
+const vec3* TerrainCache::getGrassPositions()
+{
+	return ((const vec3*)(mappedData + getHeader()->grassOffset));
+}
+
+const vec3* TerrainCache::getOasisPositions()
+{
+	return ((const vec3*)(mappedData + getHeader()->oasisOffset));
+}
+
+const float* TerrainCache::getHeightMap()
+{
+	return ((const float*)(mappedData + getHeader()->heightMapOffset));
+}
+
+const unsigned char* TerrainCache::getBiomeMap()
+{
+	return ((const unsigned char*)(mappedData + getHeader()->biomeMapOffset));
+}
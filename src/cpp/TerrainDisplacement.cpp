@@ -0,0 +1,140 @@
+#include "..\h\TerrainDisplacement.h"
+#include "..\h\TerrainLOD.h"
+
+#include <iostream>
+#include <algorithm>
+
+TerrainDisplacement::TerrainDisplacement(const TerrainConfig& cfg, const vector<float>& heightMap, const vector<unsigned char>& biomeMap, Shader* terrainShader)
+{
+	config = cfg;
+	shaders = terrainShader;
+
+	// Enough patches to cover every square of the map
+	patchesPerSide = (config.getRowChunks() + DISPLACE_PATCH_SIZE - 1) / DISPLACE_PATCH_SIZE;
+
+	// The GL objects are made by the first uploadTextures
+	patchVAO = NULL;
+	patchIndexCount = 0;
+	heightTexture = 0;
+	biomeTexture = 0;
+	heightRows = 0;
+	biomeRows = 0;
+
+	createTextureData(heightMap, biomeMap);
+}
+
+TerrainDisplacement::~TerrainDisplacement()
+{
+	delete patchVAO;
+
+	glDeleteTextures(1, &heightTexture);
+	glDeleteTextures(1, &biomeTexture);
+}
+
+// Uploads the height and biome textures, up to maxBytes of them, so a new
+// world's textures can be spread over several frames. Makes the textures
+// and patch mesh on the first call. Returns the bytes uploaded.
+int TerrainDisplacement::uploadTextures(int maxBytes)
+{
+	if (patchVAO == NULL)
+	{
+		patchVAO = TerrainLOD::createPatch(DISPLACE_PATCH_SIZE, &patchIndexCount);
+
+		heightTexture = TerrainLOD::createMapTexture(config.gridSize, GL_R16, GL_RED, GL_UNSIGNED_SHORT, NULL);
+		biomeTexture = TerrainLOD::createMapTexture(config.gridSize, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+		TerrainLOD::setMapUniforms(shaders, config);
+
+		// Compare with what the terrain mesh (vertices and indices) would need
+		size_t meshMemory = (size_t)config.getDrawVertexCount() * sizeof(VAO::VertexData) + (size_t)config.getDrawChunkIndices() * sizeof(GLushort);
+
+		cout << "GPU displacement uses " << getGPUMemory() / 1024 << " KB of terrain buffers/textures ("
+			<< meshMemory / 1024 << " KB for the mesh)\n";
+	}
+
+	int bytes = TerrainLOD::uploadMapRows(heightTexture, config.gridSize, GL_RED, GL_UNSIGNED_SHORT, config.gridSize * (int)sizeof(unsigned short), heightPixels.data(), &heightRows, maxBytes);
+	bytes += TerrainLOD::uploadMapRows(biomeTexture, config.gridSize, GL_RGBA, GL_UNSIGNED_BYTE, config.gridSize * 4, biomePixels.data(), &biomeRows, maxBytes - bytes);
+
+	// The GPU has its own copy now
+	if (isUploaded())
+	{
+		vector<unsigned short>().swap(heightPixels);
+		vector<unsigned char>().swap(biomePixels);
+	}
+
+	return (bytes);
+}
+
+// Whether the textures have been fully uploaded.
+bool TerrainDisplacement::isUploaded()
+{
+	return (heightRows == config.gridSize && biomeRows == config.gridSize);
+}
+
+// Returns the number of triangles submitted in the last draw.
+int TerrainDisplacement::getDrawnTriangles()
+{
+	return (patchesPerSide * patchesPerSide * (patchIndexCount / 3));
+}
+
+// Returns the GPU memory used for the terrain - textures and the patch mesh.
+size_t TerrainDisplacement::getGPUMemory()
+{
+	const int patchVertices = DISPLACE_PATCH_SIZE + 1;
+
+	size_t textures = (size_t)config.getMapSize() * (sizeof(unsigned short) + 4);
+	size_t patch = (size_t)patchVertices * patchVertices * sizeof(VAO::VertexData) + (size_t)patchIndexCount * sizeof(GLuint);
+
+	return (textures + patch);
+}
+
+// Works out the texture data - the terrain heights (16 bit, scaled to the
+// height range of the map) and biome colours.
+void TerrainDisplacement::createTextureData(const vector<float>& heightMap, const vector<unsigned char>& biomeMap)
+{
+	float minHeight = heightMap[0];
+	float maxHeight = heightMap[0];
+
+	for (int i = 1; i < config.getMapSize(); i++)
+	{
+		minHeight = std::min(minHeight, heightMap[i]);
+		maxHeight = std::max(maxHeight, heightMap[i]);
+	}
+
+	heightMin = minHeight;
+	heightScale = maxHeight > minHeight ? maxHeight - minHeight : 1.0f;
+
+	heightPixels.resize(config.getMapSize());
+
+	for (int i = 0; i < config.getMapSize(); i++)
+	{
+		heightPixels[i] = (unsigned short)((heightMap[i] - heightMin) / heightScale * 65535.0f + 0.5f);
+	}
+
+	TerrainLOD::getBiomeColours(biomeMap, &biomePixels);
+}
+
+// Draws one displaced patch per square of the map. Assumes the terrain
+// textures are already bound.
+void TerrainDisplacement::drawTerrain()
+{
+	shaders->use();
+	shaders->setInt("renderMode", 2);
+	shaders->setInt("patchSize", DISPLACE_PATCH_SIZE);
+	shaders->setInt("patchesPerSide", patchesPerSide);
+	shaders->setFloat("heightScale", heightScale);
+	shaders->setFloat("heightMin", heightMin);
+
+	glActiveTexture(GL_TEXTURE0 + MAP_HEIGHT_TEXTURE_SLOT);
+	glBindTexture(GL_TEXTURE_2D, heightTexture);
+	glActiveTexture(GL_TEXTURE0 + MAP_BIOME_TEXTURE_SLOT);
+	glBindTexture(GL_TEXTURE_2D, biomeTexture);
+
+	patchVAO->bind();
+
+	glDrawElementsInstanced(GL_TRIANGLES, patchIndexCount, GL_UNSIGNED_INT, 0, patchesPerSide * patchesPerSide);
+
+	patchVAO->unbind();
+
+	shaders->setInt("renderMode", 0);
+}
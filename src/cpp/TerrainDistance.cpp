@@ -0,0 +1,164 @@
+#include "..\h\TerrainDistance.h"
+#include "..\h\TerrainGenerator.h"
+#include "..\h\ThreadPool.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+// Where along a row the parabolas of two columns cross - each is
+// (columns away)^2 + (its column distance)^2
+static inline double getCrossing(const double* squared, int col, int other)
+{
+	return (((squared[col] + (double)col * col) - (squared[other] + (double)other * other)) / (2.0 * (col - other)));
+}
+
+TerrainDistance::TerrainDistance(const TerrainConfig& cfg)
+{
+	config = cfg;
+	buildMs = 0.0;
+}
+
+// Fills distances (one per vertex, row by row, as 16 bit half floats) with
+// the distance from each vertex to the nearest vertex of sourceBiome, in
+// terrain units. Every distance is infinite if there are none.
+void TerrainDistance::build(const vector<unsigned char>& biomeMap, unsigned char sourceBiome, vector<unsigned short>* distances)
+{
+	auto start = chrono::steady_clock::now();
+
+	const int gridSize = config.gridSize;
+
+	// Distance in rows to the nearest source vertex in the same column
+	vector<int> columnDistances(config.getMapSize());
+
+	distances->resize(config.getMapSize());
+
+	int numColumnBlocks = (gridSize + DISTANCE_BLOCK_COLUMNS - 1) / DISTANCE_BLOCK_COLUMNS;
+
+	ThreadPool::getShared()->parallelFor(numColumnBlocks, [&](int block)
+	{
+		columnPass(biomeMap.data(), sourceBiome, columnDistances.data(), block * DISTANCE_BLOCK_COLUMNS, std::min((block + 1) * DISTANCE_BLOCK_COLUMNS, gridSize));
+	});
+
+	int blockRows = std::max(GEN_BLOCK_BYTES / (gridSize * (int)sizeof(int)), 1);
+	int numRowBlocks = (gridSize + blockRows - 1) / blockRows;
+
+	ThreadPool::getShared()->parallelFor(numRowBlocks, [&](int block)
+	{
+		rowPass(columnDistances.data(), distances->data(), block * blockRows, std::min((block + 1) * blockRows, gridSize));
+	});
+
+	buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Returns how long the last build took.
+double TerrainDistance::getBuildMs()
+{
+	return (buildMs);
+}
+
+// Sweeps a block of columns down and back up the map, a row at a time, so
+// each step reads and writes a short run of each row. Columns with no source
+// vertex are given a distance of twice the map size - further than any real
+// distance.
+void TerrainDistance::columnPass(const unsigned char* biomes, unsigned char sourceBiome, int* columnDistances, int firstCol, int endCol)
+{
+	const int gridSize = config.gridSize;
+	const int none = gridSize * 2;
+
+	for (int col = firstCol; col < endCol; col++)
+	{
+		columnDistances[col] = biomes[col] == sourceBiome ? 0 : none;
+	}
+
+	for (int row = 1; row < gridSize; row++)
+	{
+		int* current = columnDistances + row * gridSize;
+		const int* previous = current - gridSize;
+
+		for (int col = firstCol; col < endCol; col++)
+		{
+			current[col] = biomes[row * gridSize + col] == sourceBiome ? 0 : std::min(previous[col] + 1, none);
+		}
+	}
+
+	for (int row = gridSize - 2; row >= 0; row--)
+	{
+		int* current = columnDistances + row * gridSize;
+		const int* next = current + gridSize;
+
+		for (int col = firstCol; col < endCol; col++)
+		{
+			current[col] = std::min(current[col], next[col] + 1);
+		}
+	}
+}
+
+// For each vertex in a block of rows, finds the column whose parabola
+// (columns away)^2 + (its column distance)^2 is lowest there. The parabolas
+// that are lowest anywhere along the row are found first, in one pass, then
+// the row is walked through them in order.
+void TerrainDistance::rowPass(const int* columnDistances, unsigned short* distances, int firstRow, int endRow)
+{
+	const int gridSize = config.gridSize;
+	const double none = (double)(gridSize * 2) * (gridSize * 2);
+
+	// Columns of the lowest parabolas, and where along the row each takes over
+	vector<int> lowest(gridSize);
+	vector<double> bounds(gridSize + 1);
+	vector<double> squared(gridSize);
+
+	for (int row = firstRow; row < endRow; row++)
+	{
+		const int* rowDistances = columnDistances + row * gridSize;
+
+		for (int col = 0; col < gridSize; col++)
+		{
+			squared[col] = (double)rowDistances[col] * rowDistances[col];
+		}
+
+		int k = 0;
+
+		lowest[0] = 0;
+		bounds[0] = -numeric_limits<double>::infinity();
+		bounds[1] = numeric_limits<double>::infinity();
+
+		for (int col = 1; col < gridSize; col++)
+		{
+			// Parabolas this one is lower than from before they take over are
+			// dropped - the first bound is -infinity, so at least one is kept
+			double crossing = getCrossing(squared.data(), col, lowest[k]);
+
+			while (crossing <= bounds[k])
+			{
+				k--;
+				crossing = getCrossing(squared.data(), col, lowest[k]);
+			}
+
+			k++;
+			lowest[k] = col;
+			bounds[k] = crossing;
+			bounds[k + 1] = numeric_limits<double>::infinity();
+		}
+
+		k = 0;
+
+		for (int col = 0; col < gridSize; col++)
+		{
+			while (bounds[k + 1] < col)
+			{
+				k++;
+			}
+
+			int offset = col - lowest[k];
+			double distance = squared[lowest[k]] + (double)offset * offset;
+
+			float terrainDistance = distance >= none ? numeric_limits<float>::infinity() : sqrtf((float)distance) * config.verticeOffset;
+
+			distances[row * gridSize + col] = (unsigned short)glm::packHalf1x16(terrainDistance);
+		}
+	}
+}
@@ -0,0 +1,369 @@
+#include "..\h\TerrainErosion.h"
+#include "..\h\TerrainGenerator.h"
+#include "..\h\ThreadPool.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <math.h>
+
+// SSE is available on every x86/x64 target
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define TERRAIN_SSE
+#endif
+
+// Height and slope of the height map at a point between vertices, from the
+// four vertices around it
+static float sampleHeight(const float* heights, int gridSize, float x, float y, float* gradX, float* gradY)
+{
+	int cellX = (int)x;
+	int cellY = (int)y;
+	float fracX = x - cellX;
+	float fracY = y - cellY;
+
+	int i = cellY * gridSize + cellX;
+
+	float h00 = heights[i];
+	float h10 = heights[i + 1];
+	float h01 = heights[i + gridSize];
+	float h11 = heights[i + gridSize + 1];
+
+	*gradX = (h10 - h00) * (1.0f - fracY) + (h11 - h01) * fracY;
+	*gradY = (h01 - h00) * (1.0f - fracX) + (h11 - h10) * fracX;
+
+	return (h00 * (1.0f - fracX) * (1.0f - fracY) + h10 * fracX * (1.0f - fracY)
+		+ h01 * (1.0f - fracX) * fracY + h11 * fracX * fracY);
+}
+
+// Adds an amount to the four vertices around a point, weighted by how close
+// the point is to each
+static void addHeight(float* heights, int gridSize, float x, float y, float amount)
+{
+	int cellX = (int)x;
+	int cellY = (int)y;
+	float fracX = x - cellX;
+	float fracY = y - cellY;
+
+	int i = cellY * gridSize + cellX;
+
+	heights[i]					+= amount * (1.0f - fracX) * (1.0f - fracY);
+	heights[i + 1]				+= amount * fracX * (1.0f - fracY);
+	heights[i + gridSize]		+= amount * (1.0f - fracX) * fracY;
+	heights[i + gridSize + 1]	+= amount * fracX * fracY;
+}
+
+// Removes an amount from the vertices within ERODE_RADIUS of a vertex, more
+// from the closer ones, so droplets wear the ground down smoothly instead of
+// digging pits
+static void removeHeight(float* heights, int gridSize, int x, int y, float amount)
+{
+	float weights[(ERODE_RADIUS * 2 + 1) * (ERODE_RADIUS * 2 + 1)];
+	float totalWeight = 0.0f;
+	int n = 0;
+
+	for (int offsetY = -ERODE_RADIUS; offsetY <= ERODE_RADIUS; offsetY++)
+	{
+		for (int offsetX = -ERODE_RADIUS; offsetX <= ERODE_RADIUS; offsetX++, n++)
+		{
+			int brushX = x + offsetX;
+			int brushY = y + offsetY;
+
+			weights[n] = 0.0f;
+
+			if (brushX >= 0 && brushX < gridSize && brushY >= 0 && brushY < gridSize)
+			{
+				weights[n] = std::max(ERODE_RADIUS - sqrtf((float)(offsetX * offsetX + offsetY * offsetY)), 0.0f);
+				totalWeight += weights[n];
+			}
+		}
+	}
+
+	n = 0;
+
+	for (int offsetY = -ERODE_RADIUS; offsetY <= ERODE_RADIUS; offsetY++)
+	{
+		for (int offsetX = -ERODE_RADIUS; offsetX <= ERODE_RADIUS; offsetX++, n++)
+		{
+			if (weights[n] > 0.0f)
+			{
+				heights[(y + offsetY) * gridSize + x + offsetX] -= amount * weights[n] / totalWeight;
+			}
+		}
+	}
+}
+
+TerrainErosion::TerrainErosion(const TerrainConfig& cfg)
+{
+	config = cfg;
+	seed = config.getErosionSeed();
+
+	talus = tanf(ERODE_TALUS_ANGLE * 3.14159265f / 180.0f) * config.verticeOffset;
+}
+
+// Runs every erosion iteration over a row by row height map, and reports how
+// long each stage took.
+void TerrainErosion::erode(vector<float>* heights)
+{
+	vector<float> eroded(heights->size());
+
+	double hydraulicTime = 0.0;
+	double thermalTime = 0.0;
+
+	for (int i = 0; i < config.erosionIterations; i++)
+	{
+		auto hydraulicStart = chrono::steady_clock::now();
+
+		hydraulicPass(heights->data(), i);
+
+		auto thermalStart = chrono::steady_clock::now();
+
+		thermalPass(heights->data(), eroded.data());
+		heights->swap(eroded);
+
+		auto thermalEnd = chrono::steady_clock::now();
+
+		hydraulicTime += chrono::duration<double>(thermalStart - hydraulicStart).count();
+		thermalTime += chrono::duration<double>(thermalEnd - thermalStart).count();
+	}
+
+	double cells = (double)config.getMapSize() * config.erosionIterations;
+
+	cout << "Eroded " << config.gridSize << "x" << config.gridSize << " terrain (" << config.erosionIterations << " iterations) in "
+		<< (hydraulicTime + thermalTime) * 1000.0 << " ms - " << cells / (hydraulicTime + thermalTime) / 1.0e6 << " M cells/s (hydraulic "
+		<< cells / hydraulicTime / 1.0e6 << " M cells/s, thermal " << cells / thermalTime / 1.0e6 << " M cells/s)\n";
+}
+
+// Drops water droplets over the whole map. The map is split into tiles, and
+// the tiles are run in four phases (by odd/even tile column and row), with
+// the tiles in each phase run in parallel.
+void TerrainErosion::hydraulicPass(float* heights, int iteration)
+{
+	const int cells = config.getRowChunks();
+
+	// Move the tile grid each iteration so droplets cross the last one's edges
+	int offsetX = Random::range(seed, Random::EROSION_SEED, iteration * 2, 0, ERODE_TILE_SIZE - 1);
+	int offsetY = Random::range(seed, Random::EROSION_SEED, iteration * 2 + 1, 0, ERODE_TILE_SIZE - 1);
+
+	int tilesX = (cells + offsetX + ERODE_TILE_SIZE - 1) / ERODE_TILE_SIZE;
+	int tilesY = (cells + offsetY + ERODE_TILE_SIZE - 1) / ERODE_TILE_SIZE;
+
+	vector<int> phaseTiles;
+
+	for (int phase = 0; phase < 4; phase++)
+	{
+		phaseTiles.clear();
+
+		for (int tileY = phase / 2; tileY < tilesY; tileY += 2)
+		{
+			for (int tileX = phase % 2; tileX < tilesX; tileX += 2)
+			{
+				phaseTiles.push_back(tileY * tilesX + tileX);
+			}
+		}
+
+		ThreadPool::getShared()->parallelFor((int)phaseTiles.size(), [&](int block)
+		{
+			int tile = phaseTiles[block];
+			int tileX = tile % tilesX;
+			int tileY = tile / tilesX;
+
+			int minX = std::max(tileX * ERODE_TILE_SIZE - offsetX, 0);
+			int minY = std::max(tileY * ERODE_TILE_SIZE - offsetY, 0);
+			int maxX = std::min((tileX + 1) * ERODE_TILE_SIZE - offsetX, cells);
+			int maxY = std::min((tileY + 1) * ERODE_TILE_SIZE - offsetY, cells);
+
+			erodeTile(heights, iteration, tile, minX, minY, maxX, maxY);
+		});
+	}
+}
+
+// Runs the droplets for one tile, one after another. Droplets stay within the
+// tile's cells (minX <= x < maxX), so only vertices up to ERODE_RADIUS outside
+// the tile are changed - never those of another tile in the same phase.
+void TerrainErosion::erodeTile(float* heights, int iteration, int tile, int minX, int minY, int maxX, int maxY)
+{
+	const int gridSize = config.gridSize;
+	const int droplets = std::max((maxX - minX) * (maxY - minY) / ERODE_CELLS_PER_DROPLET, 1);
+
+	uint32_t tileSeed = Random::hash(Random::hash(seed, Random::EROSION_DROPLET, iteration), Random::EROSION_DROPLET, tile);
+
+	for (int d = 0; d < droplets; d++)
+	{
+		// Random start within the tile (24 bits of the hash, as a fraction).
+		// Adding to minX can round up to maxX, so clamp below it to keep the
+		// first samples inside the tile
+		float posX = minX + (Random::hash(tileSeed, Random::EROSION_DROPLET, d * 2) >> 8) / 16777216.0f * (maxX - minX);
+		float posY = minY + (Random::hash(tileSeed, Random::EROSION_DROPLET, d * 2 + 1) >> 8) / 16777216.0f * (maxY - minY);
+
+		posX = std::min(posX, nextafterf((float)maxX, (float)minX));
+		posY = std::min(posY, nextafterf((float)maxY, (float)minY));
+
+		float dirX = 0.0f;
+		float dirY = 0.0f;
+		float speed = 1.0f;
+		float water = 1.0f;
+		float sediment = 0.0f;
+
+		for (int step = 0; step < ERODE_MAX_LIFETIME; step++)
+		{
+			float gradX, gradY;
+			float height = sampleHeight(heights, gridSize, posX, posY, &gradX, &gradY);
+
+			// Run downhill, keeping some of the old direction
+			dirX = dirX * ERODE_INERTIA - gradX * (1.0f - ERODE_INERTIA);
+			dirY = dirY * ERODE_INERTIA - gradY * (1.0f - ERODE_INERTIA);
+
+			float length = sqrtf(dirX * dirX + dirY * dirY);
+
+			if (length == 0.0f)
+			{
+				break;
+			}
+
+			dirX /= length;
+			dirY /= length;
+
+			float oldX = posX;
+			float oldY = posY;
+
+			posX += dirX;
+			posY += dirY;
+
+			// Droplets leaving the tile stop, and drop their sediment
+			if (posX < minX || posX >= maxX || posY < minY || posY >= maxY)
+			{
+				addHeight(heights, gridSize, oldX, oldY, sediment);
+				sediment = 0.0f;
+				break;
+			}
+
+			float unused;
+			float deltaHeight = sampleHeight(heights, gridSize, posX, posY, &unused, &unused) - height;
+
+			// Faster, wetter droplets going down steeper slopes carry more
+			float capacity = std::max(-deltaHeight * speed * water * ERODE_CAPACITY, ERODE_MIN_CAPACITY);
+
+			if (sediment > capacity || deltaHeight > 0.0f)
+			{
+				// Going uphill - fill the hole behind, otherwise drop what
+				// can't be carried
+				float deposit = deltaHeight > 0.0f ? std::min(deltaHeight, sediment) : (sediment - capacity) * ERODE_DEPOSIT_SPEED;
+
+				sediment -= deposit;
+				addHeight(heights, gridSize, oldX, oldY, deposit);
+			}
+			else
+			{
+				// Never dig deeper than the ground the droplet runs down to
+				float erode = std::min((capacity - sediment) * ERODE_ERODE_SPEED, -deltaHeight);
+
+				sediment += erode;
+				removeHeight(heights, gridSize, (int)oldX, (int)oldY, erode);
+			}
+
+			speed = sqrtf(std::max(speed * speed - deltaHeight * ERODE_GRAVITY, 0.0f));
+			water *= 1.0f - ERODE_EVAPORATE_SPEED;
+		}
+
+		// Whatever is left settles where the droplet ended
+		if (sediment > 0.0f)
+		{
+			addHeight(heights, gridSize, posX, posY, sediment);
+		}
+	}
+}
+
+// Moves height from every vertex steeper than the talus angle to its lower
+// neighbours. Reads src and writes dst, so each vertex only depends on the
+// last pass and rows can be done in parallel.
+void TerrainErosion::thermalPass(const float* src, float* dst)
+{
+	int blockRows = std::max(GEN_BLOCK_BYTES / (config.gridSize * (int)sizeof(float)), 1);
+	int numBlocks = (config.gridSize + blockRows - 1) / blockRows;
+
+	ThreadPool::getShared()->parallelFor(numBlocks, [&](int block)
+	{
+		thermalRows(src, dst, block * blockRows, std::min((block + 1) * blockRows, config.gridSize));
+	});
+}
+
+// Thermal pass for a range of rows. The inside of the map is done four
+// vertices at a time with SSE, and the map edges one at a time.
+void TerrainErosion::thermalRows(const float* src, float* dst, int firstRow, int endRow)
+{
+	const int gridSize = config.gridSize;
+
+	for (int y = firstRow; y < endRow; y++)
+	{
+		int x = 0;
+
+		if (y == 0 || y == gridSize - 1)
+		{
+			for (; x < gridSize; x++)
+			{
+				dst[y * gridSize + x] = getThermalCell(src, x, y);
+			}
+
+			continue;
+		}
+
+		dst[y * gridSize] = getThermalCell(src, 0, y);
+		x = 1;
+
+#ifdef TERRAIN_SSE
+		const __m128 talus4 = _mm_set1_ps(talus);
+		const __m128 rate4 = _mm_set1_ps(ERODE_THERMAL_RATE);
+		const __m128 zero = _mm_setzero_ps();
+
+		for (; x + 4 <= gridSize - 1; x += 4)
+		{
+			const float* centre = src + y * gridSize + x;
+
+			__m128 height = _mm_loadu_ps(centre);
+			__m128 neighbours[4] = { _mm_loadu_ps(centre - 1), _mm_loadu_ps(centre + 1),
+				_mm_loadu_ps(centre - gridSize), _mm_loadu_ps(centre + gridSize) };
+
+			__m128 flow = zero;
+
+			for (int n = 0; n < 4; n++)
+			{
+				// Gains from higher neighbours, loses to lower ones
+				__m128 diff = _mm_sub_ps(neighbours[n], height);
+
+				flow = _mm_add_ps(flow, _mm_max_ps(_mm_sub_ps(diff, talus4), zero));
+				flow = _mm_add_ps(flow, _mm_min_ps(_mm_add_ps(diff, talus4), zero));
+			}
+
+			_mm_storeu_ps(dst + y * gridSize + x, _mm_add_ps(height, _mm_mul_ps(flow, rate4)));
+		}
+#endif
+
+		for (; x < gridSize; x++)
+		{
+			dst[y * gridSize + x] = getThermalCell(src, x, y);
+		}
+	}
+}
+
+// Thermal pass for a single vertex. Neighbours off the edge of the map are
+// treated as the same height, so nothing flows over the edge.
+float TerrainErosion::getThermalCell(const float* src, int x, int y)
+{
+	const int gridSize = config.gridSize;
+
+	float height = src[y * gridSize + x];
+	float neighbours[4] = { src[y * gridSize + std::max(x - 1, 0)], src[y * gridSize + std::min(x + 1, gridSize - 1)],
+		src[std::max(y - 1, 0) * gridSize + x], src[std::min(y + 1, gridSize - 1) * gridSize + x] };
+
+	float flow = 0.0f;
+
+	for (int n = 0; n < 4; n++)
+	{
+		float diff = neighbours[n] - height;
+
+		flow += std::max(diff - talus, 0.0f) + std::min(diff + talus, 0.0f);
+	}
+
+	return (height + flow * ERODE_THERMAL_RATE);
+}
@@ -0,0 +1,762 @@
+#include "..\h\TerrainGenerator.h"
+
+// Noise - height maps, model placement
+#include "..\h\TerrainNoise.h"
+
+#include "..\h\ThreadPool.h"
+#include "..\h\TerrainErosion.h"
+#include "..\h\TerrainDistance.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+// SSE is available on every x86/x64 target
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define TERRAIN_SSE
+#endif
+
+// Biome classification. The summed height noise splits the map into bands,
+// from the oasis up to the grass, and pathways (low path noise) change the
+// biome within a band. Each boundary is the height a band starts at, and
+// whether a height exactly on it belongs to the band above.
+struct BandBoundary
+{
+	float	height;
+	bool	inclusive;
+};
+
+#define BIOME_BANDS		5
+#define PATH_BOUND		0.2f	// Path noise below this is a pathway
+
+static constexpr BandBoundary bandBoundaries[BIOME_BANDS - 1] =
+{
+	{ -0.35f, false },	// Oasis (water) up to -0.35
+	{ -0.3f, false },	// Sand mixed with water up to -0.3 - trees grow around the water here
+	{ 0.5f, true },		// Desert below 0.5
+	{ 0.55f, true }		// Sand mixed with grass below 0.55, grass (with cacti) above
+};
+
+// Biome of each band, off and on a pathway
+static constexpr TerrainGenerator::Biome bandBiomes[BIOME_BANDS][2] =
+{
+	{ TerrainGenerator::OASIS, TerrainGenerator::OASIS },
+	{ TerrainGenerator::DESERT_OASIS, TerrainGenerator::DESERT_OASIS },
+	{ TerrainGenerator::DESERT, TerrainGenerator::DESERT_PATH },
+	{ TerrainGenerator::GRASS_DESERT, TerrainGenerator::GRASS_DESERT },
+	{ TerrainGenerator::GRASS, TerrainGenerator::GRASS }
+};
+
+const TerrainGenerator::BiomeInfo TerrainGenerator::biomeTable[BIOME_COUNT] =
+{
+	// GRASS - grass and cacti
+	{ { 0.0f, 1.0f, 0.0f, 0.0f }, GRASS, MODELS_GRASS, 0.95f, REGION_GRASS },
+	// GRASS_DESERT - grass-desert transition
+	{ { 0.5f, 1.0f, 0.0f, 0.0f }, GRASS, MODELS_NONE, 0.0f, REGION_GRASS },
+	// DESERT - normal sand
+	{ { 1.0f, 0.0f, 0.0f, 0.0f }, DESERT, MODELS_NONE, 0.0f, REGION_NONE },
+	// DESERT_PATH - sandy pathway
+	{ { 0.0f, 0.0f, 0.0f, 1.0f }, DESERT, MODELS_NONE, 0.0f, REGION_NONE },
+	// DESERT_OASIS - desert-water transition, with grass and trees
+	{ { 1.0f, 0.0f, 0.5f, 0.0f }, DESERT, MODELS_OASIS, 0.99f, REGION_OASIS },
+	// OASIS - water
+	{ { 0.0f, 0.0f, 1.0f, 0.0f }, OASIS, MODELS_NONE, 0.0f, REGION_OASIS }
+};
+
+TerrainGenerator::TerrainGenerator(const TerrainConfig& cfg)
+{
+	config = cfg;
+
+	// Size the maps from the config - the vertices are only sized when the
+	// full mesh is generated or loaded
+	heightMap.resize(config.getMapSize());
+	biomeMap.resize(config.getMapSize());
+}
+
+// Runs every stage of generation, timing each. With heightsOnly, no vertices
+// are made (so no texture coordinates or normals either) - only the heights,
+// biomes and model positions.
+void TerrainGenerator::generate(bool heightsOnly)
+{
+	stageTimes.clear();
+
+	if (!heightsOnly)
+	{
+		terrainVertices.resize(config.getMapSize());
+	}
+
+	runStage("Vertices", &TerrainGenerator::generateVertices);
+	runStage("Landscape", &TerrainGenerator::generateLandscape);
+
+	if (config.erosionIterations > 0)
+	{
+		runStage("Erosion", &TerrainGenerator::erodeTerrain);
+	}
+
+	runStage("Water distance", &TerrainGenerator::createWaterDistanceMap);
+
+	if (!heightsOnly)
+	{
+		runStage("Texture coords", &TerrainGenerator::setTextureCoords);
+		runStage("Normals", static_cast<void (TerrainGenerator::*)()>(&TerrainGenerator::generateNormals));
+	}
+}
+
+// Runs one stage of generation and records how long it took.
+void TerrainGenerator::runStage(const string& name, void (TerrainGenerator::*stage)())
+{
+	auto start = chrono::steady_clock::now();
+
+	(this->*stage)();
+
+	auto end = chrono::steady_clock::now();
+
+	StageTime time;
+	time.name = name;
+	time.ms = chrono::duration<double, milli>(end - start).count();
+
+	stageTimes.push_back(time);
+}
+
+// Returns the generated vertices, row by row.
+const vector<VertexData>& TerrainGenerator::getVertices()
+{
+	return (terrainVertices);
+}
+
+// Returns the height of every vertex, row by row - empty once the heights
+// are kept as half floats.
+const vector<float>& TerrainGenerator::getHeightMap() const
+{
+	return (heightMap);
+}
+
+// Returns the biome of every vertex, row by row.
+const vector<unsigned char>& TerrainGenerator::getBiomeMap() const
+{
+	return (biomeMap);
+}
+
+// Returns the time taken by each stage of the last generate().
+const vector<TerrainGenerator::StageTime>& TerrainGenerator::getStageTimes()
+{
+	return (stageTimes);
+}
+
+// Returns the settings this terrain was generated with.
+const TerrainConfig& TerrainGenerator::getConfig()
+{
+	return (config);
+}
+
+// Returns either 0 (grass model) or 1 (tree or cactus model, depending on the biome) 
+// to determine a randomised model at a given position.
+const int TerrainGenerator::getModelType(int idx)
+{
+	return (Random::range(config.worldSeed, Random::MODEL_TYPE, idx, 0, 1));
+}
+
+// Retrieves a random rotation (-180 to 180 degrees) to apply to a given model.
+const int TerrainGenerator::getRotation(int idx)
+{
+	return (Random::range(config.worldSeed, Random::MODEL_ROTATION, idx, -180, 180));
+}
+
+// Retrieves a random scaling factor (divisor, 1 or 2) to apply to a given model.
+const int TerrainGenerator::getScale(int idx)
+{
+	return (Random::range(config.worldSeed, Random::MODEL_SCALE, idx, 1, 2));
+}
+
+// Gets the band a height falls in - counts the boundaries it is above,
+// without branching
+static inline int getBiomeBand(float terrain)
+{
+	int band = 0;
+
+	for (int i = 0; i < BIOME_BANDS - 1; i++)
+	{
+		band += (terrain > bandBoundaries[i].height) | (bandBoundaries[i].inclusive & (terrain == bandBoundaries[i].height));
+	}
+
+	return (band);
+}
+
+// Gets the biome type at a given point on the terrain given the relevant
+// noise values
+TerrainGenerator::Biome TerrainGenerator::getBiome(float terrain, float path)
+{
+	return (bandBiomes[getBiomeBand(terrain)][path < PATH_BOUND]);
+}
+
+// Gets the biomes of a row of points at once, from their summed height
+// noise and path noise - the same as getBiome() for each
+void TerrainGenerator::getBiomes(const float* terrain, const float* path, int count, unsigned char* biomes)
+{
+	int i = 0;
+
+#ifdef TERRAIN_SSE
+	// Band and pathway of four points at a time - each comparison gives 0
+	// or -1 per lane, so subtracting the masks counts the boundaries passed
+	const __m128 pathBounds = _mm_set1_ps(PATH_BOUND);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 heights = _mm_loadu_ps(terrain + i);
+		__m128 bands = _mm_setzero_ps();
+
+		for (int b = 0; b < BIOME_BANDS - 1; b++)
+		{
+			__m128 bound = _mm_set1_ps(bandBoundaries[b].height);
+			__m128 above = bandBoundaries[b].inclusive ? _mm_cmpge_ps(heights, bound) : _mm_cmpgt_ps(heights, bound);
+
+			bands = _mm_add_ps(bands, _mm_and_ps(above, _mm_set1_ps(1.0f)));
+		}
+
+		int onPath = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(path + i), pathBounds));
+
+		float band[4];
+		_mm_storeu_ps(band, bands);
+
+		for (int lane = 0; lane < 4; lane++)
+		{
+			biomes[i + lane] = (unsigned char)bandBiomes[(int)band[lane]][(onPath >> lane) & 1];
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		biomes[i] = (unsigned char)getBiome(terrain[i], path[i]);
+	}
+}
+
+// Gets if a model should be placed at a given position, provided
+// the biome and generated noise value
+bool TerrainGenerator::getIfModelPlacement(Biome biome, float noise)
+{
+	return (biomeTable[biome].models != MODELS_NONE && noise > biomeTable[biome].modelBound);
+}
+
+// Gets the colour map value for a given biome. Each channel weights one
+// texture in the terrain shader - r: sand, g: grass, b: water, a: sand path.
+vec4 TerrainGenerator::getBiomeColour(Biome biome)
+{
+	const float* weights = biomeTable[biome].weights;
+
+	return (vec4(weights[0], weights[1], weights[2], weights[3]));
+}
+
+// Retrieves all of the established model positions for the grassy
+// biomes and copies them into the provided vector.
+void TerrainGenerator::getGrassModelPositions(vector<vec3>* positions)
+{
+	for (int i = 0; i < grassModelPositions.size(); i++)
+	{
+		positions->push_back(grassModelPositions[i]);
+	}
+}
+
+// Retrieves all of the established model positions for the oasis
+// biomes and copies them into the provided vector.
+void TerrainGenerator::getOasisModelPositions(vector<vec3>* positions)
+{
+	for (int i = 0; i < oasisModelPositions.size(); i++)
+	{
+		positions->push_back(oasisModelPositions[i]);
+	}
+}
+
+// Works out the x of each column and z of each row, then generates all of
+// the vertices for the terrain (if it has any - see generate)
+void TerrainGenerator::generateVertices()
+{
+	columnPositions.resize(config.gridSize);
+	rowPositions.resize(config.gridSize);
+
+	float colVerticesOffset = config.getStartPos();
+	float rowVerticesOffset = config.getStartPos();
+
+	for (int i = 0; i < config.gridSize; i++)
+	{
+		// Columns draw L->R >>>
+		columnPositions[i] = colVerticesOffset;
+		colVerticesOffset += config.verticeOffset;
+
+		// Rows are moved backwards on the z axis - draws front -> back ^^^
+		rowPositions[i] = rowVerticesOffset;
+		rowVerticesOffset -= config.verticeOffset;
+	}
+
+	if (!isMeshResident())
+	{
+		return;
+	}
+
+	for (int row = 0; row < config.gridSize; row++)
+	{
+		for (int col = 0; col < config.gridSize; col++)
+		{
+			VertexData& vertex = terrainVertices[row * config.gridSize + col];
+
+			// y axis - up ^ direction, so 0 - using Perlin noise for height maps
+			vertex.vertices = vec3(columnPositions[col], 0.0f, rowPositions[row]);
+
+			// Set normals to 0 for now
+			vertex.normals = vec3(0.0f);
+		}
+	}
+}
+
+// Generate height maps for the terrain with Perlin noise,
+// as well as create colour map based on biomes as a template for
+// the textures for the shader.
+void TerrainGenerator::generateLandscape()
+{
+	// Height, pathway and model placement noise for this terrain's seeds
+	TerrainNoise noise(config);
+
+	// Split the map into blocks of rows sized to fit in cache, and generate
+	// the blocks in parallel. Each block collects its own model positions.
+	int blockRows = GEN_BLOCK_BYTES / (config.gridSize * sizeof(VertexData));
+
+	if (blockRows < 1)
+	{
+		blockRows = 1;
+	}
+
+	int numBlocks = (config.gridSize + blockRows - 1) / blockRows;
+
+	vector<vector<vec3>> blockGrassPositions(numBlocks);
+	vector<vector<vec3>> blockOasisPositions(numBlocks);
+
+	ThreadPool::getShared()->parallelFor(numBlocks, [&](int block)
+	{
+		int firstRow = block * blockRows;
+		int endRow = firstRow + blockRows;
+
+		if (endRow > config.gridSize)
+		{
+			endRow = config.gridSize;
+		}
+
+		generateLandscapeRows(firstRow, endRow, noise, &blockGrassPositions[block], &blockOasisPositions[block]);
+	});
+
+	// Merge in block order so model positions come out in the same order
+	// regardless of how many threads were used
+	for (int i = 0; i < numBlocks; i++)
+	{
+		grassModelPositions.insert(grassModelPositions.end(), blockGrassPositions[i].begin(), blockGrassPositions[i].end());
+		oasisModelPositions.insert(oasisModelPositions.end(), blockOasisPositions[i].begin(), blockOasisPositions[i].end());
+	}
+}
+
+// Generates the heights and biome colours for rows [firstRow, endRow) of the
+// terrain. Model positions found are added to the given vectors. Only touches
+// vertices in those rows, so separate row ranges can be generated in parallel.
+void TerrainGenerator::generateLandscapeRows(int firstRow, int endRow, const TerrainNoise& noise, vector<vec3>* grassPositions, vector<vec3>* oasisPositions)
+{
+	// Noise values of the current row
+	vector<float> terrain(config.gridSize);
+	vector<float> path(config.gridSize);
+	vector<float> model(config.gridSize);
+
+	for (int x = firstRow; x < endRow; x++)
+	{
+		// Terrain vertice index
+		int terrainIndex = x * config.gridSize;
+
+		for (int y = 0; y < config.gridSize; y++)
+		{
+			// Get noise values for biome type and terrain height
+			// at the given x/y coordinate (2D position)
+			TerrainNoise::Sample sample = noise.getSample((float)x, (float)y);
+
+			// Set random height value (random noise) calculated before,
+			// to the vertex y value.
+			heightMap[terrainIndex + y] = sample.height;
+
+			terrain[y] = sample.terrain;
+			path[y] = sample.path;
+			model[y] = sample.model;
+		}
+
+		getBiomes(terrain.data(), path.data(), config.gridSize, &biomeMap[terrainIndex]);
+
+		for (int y = 0; y < config.gridSize; y++)
+		{
+			Biome biome = (Biome)biomeMap[terrainIndex + y];
+
+			if (isMeshResident())
+			{
+				VertexData& vertex = terrainVertices[terrainIndex + y];
+
+				vertex.vertices.y = heightMap[terrainIndex + y];
+				vertex.colours = getBiomeColour(biome);
+			}
+
+			// Set grass/cacti around grassy areas, and grass/trees around the oasis
+			if (getIfModelPlacement(biome, model[y]))
+			{
+				vec3 position(columnPositions[y], heightMap[terrainIndex + y], rowPositions[x]);
+
+				if (biomeTable[biome].models == MODELS_GRASS)
+				{
+					grassPositions->push_back(position);
+				}
+				else
+				{
+					oasisPositions->push_back(position);
+				}
+			}
+		}
+	}
+}
+
+// Runs the erosion stage over the generated heights, if enabled. Models stay
+// on the vertex they were placed on, so are moved to its new height.
+void TerrainGenerator::erodeTerrain()
+{
+	if (config.erosionIterations <= 0)
+	{
+		return;
+	}
+
+	TerrainErosion erosion(config);
+	erosion.erode(&heightMap);
+
+	if (isMeshResident())
+	{
+		for (int i = 0; i < config.getMapSize(); i++)
+		{
+			terrainVertices[i].vertices.y = heightMap[i];
+		}
+	}
+
+	vector<vec3>* modelPositions[] = { &grassModelPositions, &oasisModelPositions };
+
+	for (int m = 0; m < 2; m++)
+	{
+		for (int i = 0; i < modelPositions[m]->size(); i++)
+		{
+			vec3& pos = (*modelPositions[m])[i];
+
+			int col = (int)roundf((pos.x - config.getStartPos()) / config.verticeOffset);
+			int row = (int)roundf((config.getStartPos() - pos.z) / config.verticeOffset);
+
+			pos.y = heightMap[row * config.gridSize + col];
+		}
+	}
+}
+
+// Works out how far every vertex is from the nearest oasis water, from the
+// biome map (see TerrainDistance).
+void TerrainGenerator::createWaterDistanceMap()
+{
+	TerrainDistance distance(config);
+	distance.build(biomeMap, (unsigned char)OASIS, &waterDistanceMap);
+}
+
+// Calculate the texture coordinates for the terrain object.
+void TerrainGenerator::setTextureCoords()
+{
+	// Terrain texture coordinate positions for each corner of the terrain
+	const int btmLeft	= 0;
+	const int btmRight	= config.gridSize - 1;
+	const int topLeft	= config.getMapSize() - config.gridSize;
+	const int topRight	= config.getMapSize() - 1;
+
+	// Texture coords - bottom left
+	terrainVertices[btmLeft].textures.x = 0.0f;
+	terrainVertices[btmLeft].textures.y = 0.0f;
+
+	// Bottom right
+	terrainVertices[btmRight].textures.x = 1.0f;
+	terrainVertices[btmRight].textures.y = 0.0f;
+
+	// Top left
+	terrainVertices[topLeft].textures.x = 0.0f;
+	terrainVertices[topLeft].textures.y = 1.0f;
+
+	// Top right
+	terrainVertices[topRight].textures.x = 1.0f;
+	terrainVertices[topRight].textures.y = 1.0f;
+
+	int z = 0;
+
+	// Scale 2D texture coordinates across the terrain between 0.0 and 1.0.
+	// Treat the terrain as one large quad
+	for (int x = 0; x < config.getMapSize(); x++)
+	{
+		div_t divResultX;
+		div_t divResultZ;
+
+		divResultX = div(x, config.gridSize);
+		divResultZ = div(z, config.gridSize);
+
+		if (x != btmLeft
+			&& x != btmRight
+			&& x != topLeft
+			&& x != topRight)
+		{
+			terrainVertices[x].textures.x = (float)divResultX.rem / config.gridSize;
+			terrainVertices[x].textures.y = (float)divResultZ.rem / config.gridSize;
+		}
+
+		// Move onward a row when at the end
+		if (divResultX.rem == config.gridSize - 1)
+		{
+			z++;
+		}
+	}
+}
+
+// Copies the terrain vertices into the layout drawn by the GPU - one block of
+// (DRAW_CHUNK_QUADS + 1)^2 vertices per chunk, row by row. Chunks that run off
+// the edge of the map repeat the last row/column, giving empty triangles.
+void TerrainGenerator::createChunkVertices(vector<VertexData>* chunkVertices)
+{
+	const int chunks = config.getDrawChunks();
+	const int chunkSide = DRAW_CHUNK_QUADS + 1;
+
+	chunkVertices->resize(config.getDrawVertexCount());
+
+	ThreadPool::getShared()->parallelFor(chunks * chunks, [&](int chunk)
+	{
+		VertexData* dst = chunkVertices->data() + (size_t)chunk * config.getDrawChunkVertices();
+
+		for (int row = 0; row < chunkSide; row++)
+		{
+			for (int col = 0; col < chunkSide; col++)
+			{
+				dst[row * chunkSide + col] = getChunkVertex(chunk, row, col);
+			}
+		}
+	});
+}
+
+// Gets the terrain vertex at a row/column within a mesh chunk, repeating the
+// last row/column of the map for chunks that run off its edge. Once the
+// vertices have been released, it is rebuilt from the maps.
+VertexData TerrainGenerator::getChunkVertex(int chunk, int row, int col)
+{
+	const int chunks = config.getDrawChunks();
+	const int lastVertex = config.gridSize - 1;
+
+	int mapRow = std::min((chunk / chunks) * DRAW_CHUNK_QUADS + row, lastVertex);
+	int mapCol = std::min((chunk % chunks) * DRAW_CHUNK_QUADS + col, lastVertex);
+
+	if (!isMeshResident())
+	{
+		return (getVertex(mapRow, mapCol));
+	}
+
+	return (terrainVertices[mapRow * config.gridSize + mapCol]);
+}
+
+// Calculate the normal map for the terrain for BlinnPhong lighting.
+void TerrainGenerator::generateNormals()
+{
+	generateNormals(0, config.gridSize, 0, config.gridSize);
+}
+
+// Calculates the normals of the vertices in rows [firstRow, endRow) and
+// columns [firstCol, endCol) - used to update the normals of part of the map
+// after its heights change. Each normal only reads the heights around its
+// own vertex, so the rows are split into blocks and calculated in parallel.
+void TerrainGenerator::generateNormals(int firstRow, int endRow, int firstCol, int endCol)
+{
+	int blockRows = GEN_BLOCK_BYTES / (config.gridSize * sizeof(VertexData));
+
+	if (blockRows < 1)
+	{
+		blockRows = 1;
+	}
+
+	int numBlocks = (endRow - firstRow + blockRows - 1) / blockRows;
+
+	ThreadPool::getShared()->parallelFor(numBlocks, [&](int block)
+	{
+		int blockStart = firstRow + block * blockRows;
+		int blockEnd = blockStart + blockRows;
+
+		if (blockEnd > endRow)
+		{
+			blockEnd = endRow;
+		}
+
+		generateNormalRows(blockStart, blockEnd, firstCol, endCol);
+	});
+}
+
+// Calculates normals for rows [firstRow, endRow) and columns [firstCol, endCol)
+// from the height difference between each vertex's left/right and up/down
+// neighbours (central differences). At the edges of the map the missing
+// neighbour is replaced by the vertex itself, with the difference doubled.
+void TerrainGenerator::generateNormalRows(int firstRow, int endRow, int firstCol, int endCol)
+{
+	const int gridSize = config.gridSize;
+	const float ySize = 2.0f * config.verticeOffset;
+
+	for (int row = firstRow; row < endRow; row++)
+	{
+		// Neighbouring heights are next to each other in the height map,
+		// so they can be loaded together
+		const float* up = &heightMap[std::max(row - 1, 0) * gridSize];
+		const float* curr = &heightMap[row * gridSize];
+		const float* down = &heightMap[std::min(row + 1, gridSize - 1) * gridSize];
+
+		float zScale = (row == 0 || row == gridSize - 1) ? 2.0f : 1.0f;
+
+		VertexData* vertices = &terrainVertices[row * gridSize];
+
+		int col = firstCol;
+
+#ifdef TERRAIN_SSE
+		// Four normals at a time, away from the left/right edges
+		if (col == 0)
+		{
+			vertices[0].normals = normalize(vec3((curr[0] - curr[1]) * 2.0f, ySize, (down[0] - up[0]) * zScale));
+			col++;
+		}
+
+		const __m128 ySizes = _mm_set1_ps(ySize);
+		const __m128 zScales = _mm_set1_ps(zScale);
+
+		for (; col + 4 <= std::min(endCol, gridSize - 1); col += 4)
+		{
+			__m128 x = _mm_sub_ps(_mm_loadu_ps(curr + col - 1), _mm_loadu_ps(curr + col + 1));
+			__m128 z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(down + col), _mm_loadu_ps(up + col)), zScales);
+
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(ySizes, ySizes)), _mm_mul_ps(z, z)));
+
+			float nx[4], ny[4], nz[4];
+
+			_mm_storeu_ps(nx, _mm_div_ps(x, length));
+			_mm_storeu_ps(ny, _mm_div_ps(ySizes, length));
+			_mm_storeu_ps(nz, _mm_div_ps(z, length));
+
+			for (int i = 0; i < 4; i++)
+			{
+				vertices[col + i].normals = vec3(nx[i], ny[i], nz[i]);
+			}
+		}
+#endif
+
+		// Any remaining vertices, including the edges
+		for (; col < endCol; col++)
+		{
+			int left = std::max(col - 1, 0);
+			int right = std::min(col + 1, gridSize - 1);
+
+			float xScale = (col == 0 || col == gridSize - 1) ? 2.0f : 1.0f;
+
+			vertices[col].normals = normalize(vec3((curr[left] - curr[right]) * xScale, ySize, (down[col] - up[col]) * zScale));
+		}
+	}
+}
+
+// Sets the height of a vertex in the height map, in whichever form it is kept.
+void TerrainGenerator::setMapHeight(int i, float height)
+{
+	if (halfHeightMap.empty())
+	{
+		heightMap[i] = height;
+	}
+	else
+	{
+		halfHeightMap[i] = (unsigned short)packHalf1x16(height);
+	}
+}
+
+// Frees the vertices once they are no longer needed on the CPU (i.e. they
+// have been uploaded), keeping only the height and biome maps. Any vertex
+// can still be rebuilt from the maps with getVertex. With halfHeights, the
+// height map is also swapped for 16 bit floats, halving it again.
+void TerrainGenerator::releaseVertices(bool halfHeights)
+{
+	if (isMeshResident())
+	{
+		columnPositions.resize(config.gridSize);
+		rowPositions.resize(config.gridSize);
+
+		for (int i = 0; i < config.gridSize; i++)
+		{
+			columnPositions[i] = terrainVertices[i].vertices.x;
+			rowPositions[i] = terrainVertices[i * config.gridSize].vertices.z;
+		}
+
+		// clear() keeps the memory - swapping with an empty vector frees it
+		vector<VertexData>().swap(terrainVertices);
+	}
+
+	if (halfHeights && halfHeightMap.empty())
+	{
+		halfHeightMap.resize(config.getMapSize());
+
+		for (int i = 0; i < config.getMapSize(); i++)
+		{
+			halfHeightMap[i] = (unsigned short)packHalf1x16(heightMap[i]);
+		}
+
+		vector<float>().swap(heightMap);
+	}
+}
+
+// Bytes held by the height, biome and water distance maps (and the row/column
+// positions).
+size_t TerrainGenerator::getMapBytes() const
+{
+	return (heightMap.capacity() * sizeof(float) + halfHeightMap.capacity() * sizeof(unsigned short)
+		+ biomeMap.capacity() + waterDistanceMap.capacity() * sizeof(unsigned short) + (columnPositions.capacity() + rowPositions.capacity()) * sizeof(float));
+}
+
+// Builds the vertex at a row/column from the height and biome maps, the same
+// as it was generated - used once the vertices have been released.
+VertexData TerrainGenerator::getVertex(int row, int col) const
+{
+	const int lastVertex = config.gridSize - 1;
+	int i = row * config.gridSize + col;
+
+	VertexData vertex;
+
+	vertex.vertices = vec3(columnPositions[col], getMapHeight(i), rowPositions[row]);
+	vertex.colours = getBiomeColour(getMapBiome(i));
+	vertex.normals = getNormal(row, col);
+
+	// The corners of the map are pinned to the corners of the texture (see
+	// setTextureCoords)
+	if ((row == 0 || row == lastVertex) && (col == 0 || col == lastVertex))
+	{
+		vertex.textures = vec2(col == 0 ? 0.0f : 1.0f, row == 0 ? 0.0f : 1.0f);
+	}
+	else
+	{
+		vertex.textures = vec2((float)col / config.gridSize, (float)row / config.gridSize);
+	}
+
+	return (vertex);
+}
+
+// Calculates the normal of one vertex from the height map, as
+// generateNormalRows does.
+vec3 TerrainGenerator::getNormal(int row, int col) const
+{
+	const int gridSize = config.gridSize;
+
+	int up = std::max(row - 1, 0) * gridSize;
+	int down = std::min(row + 1, gridSize - 1) * gridSize;
+	int left = std::max(col - 1, 0);
+	int right = std::min(col + 1, gridSize - 1);
+
+	float xScale = (col == 0 || col == gridSize - 1) ? 2.0f : 1.0f;
+	float zScale = (row == 0 || row == gridSize - 1) ? 2.0f : 1.0f;
+
+	float x = (getMapHeight(row * gridSize + left) - getMapHeight(row * gridSize + right)) * xScale;
+	float z = (getMapHeight(down + col) - getMapHeight(up + col)) * zScale;
+
+	return (normalize(vec3(x, 2.0f * config.verticeOffset, z)));
+}
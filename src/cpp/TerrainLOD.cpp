@@ -0,0 +1,509 @@
+#include "..\h\TerrainLOD.h"
+#include "..\h\ThreadPool.h"
+
+#include <math.h>
+#include <algorithm>
+
+// Used as the range of the top level, which is always detailed enough
+#define LOD_UNLIMITED_RANGE		1.0e30f
+
+TerrainLOD::TerrainLOD(const TerrainConfig& cfg, const vector<float>& heightMap, const vector<unsigned char>& biomeMap, float screenHeight, Shader* terrainShader)
+{
+	config = cfg;
+	shaders = terrainShader;
+	drawnTriangles = 0;
+
+	// The GL objects are made by the first uploadTextures
+	patchVAO = NULL;
+	patchIndexCount = 0;
+	heightTexture = 0;
+	biomeTexture = 0;
+	heightRows = 0;
+	biomeRows = 0;
+
+	// Add levels until the root node covers the whole map
+	numLevels = 1;
+	rootSize = LOD_PATCH_SIZE;
+
+	while (rootSize < config.getRowChunks())
+	{
+		rootSize *= 2;
+		numLevels++;
+	}
+
+	heightPixels = heightMap;
+	getBiomeColours(biomeMap, &biomePixels);
+
+	calcNodeHeights(heightMap);
+	calcLevelRanges(heightMap, screenHeight);
+}
+
+TerrainLOD::~TerrainLOD()
+{
+	delete patchVAO;
+
+	glDeleteTextures(1, &heightTexture);
+	glDeleteTextures(1, &biomeTexture);
+}
+
+// Uploads the height and biome textures, up to maxBytes of them, so a new
+// world's textures can be spread over several frames. Makes the textures
+// and patch mesh on the first call. Returns the bytes uploaded.
+int TerrainLOD::uploadTextures(int maxBytes)
+{
+	if (patchVAO == NULL)
+	{
+		patchVAO = createPatch(LOD_PATCH_SIZE, &patchIndexCount);
+
+		heightTexture = createMapTexture(config.gridSize, GL_R32F, GL_RED, GL_FLOAT, NULL);
+		biomeTexture = createMapTexture(config.gridSize, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+		setMapUniforms(shaders, config);
+	}
+
+	int bytes = uploadMapRows(heightTexture, config.gridSize, GL_RED, GL_FLOAT, config.gridSize * (int)sizeof(float), heightPixels.data(), &heightRows, maxBytes);
+	bytes += uploadMapRows(biomeTexture, config.gridSize, GL_RGBA, GL_UNSIGNED_BYTE, config.gridSize * 4, biomePixels.data(), &biomeRows, maxBytes - bytes);
+
+	// The GPU has its own copy now
+	if (isUploaded())
+	{
+		vector<float>().swap(heightPixels);
+		vector<unsigned char>().swap(biomePixels);
+	}
+
+	return (bytes);
+}
+
+// Whether the textures have been fully uploaded.
+bool TerrainLOD::isUploaded()
+{
+	return (heightRows == config.gridSize && biomeRows == config.gridSize);
+}
+
+// Returns the number of triangles submitted in the last draw.
+int TerrainLOD::getDrawnTriangles()
+{
+	return (drawnTriangles);
+}
+
+// Creates the patch mesh drawn for every node - a flat square grid of
+// patchSize quads, with x/z holding the patch-local grid position.
+// Also used for the patches of TerrainDisplacement.
+VAO* TerrainLOD::createPatch(int patchSize, int* indexCount)
+{
+	const int patchVertices = patchSize + 1;
+
+	vector<VAO::VertexData> vertices(patchVertices * patchVertices);
+	vector<ivec3> indices;
+
+	for (int row = 0; row < patchVertices; row++)
+	{
+		for (int col = 0; col < patchVertices; col++)
+		{
+			vertices[row * patchVertices + col].vertices = vec3((float)col, 0.0f, (float)row);
+		}
+	}
+
+	for (int row = 0; row < patchSize; row++)
+	{
+		for (int col = 0; col < patchSize; col++)
+		{
+			int topLeft = row * patchVertices + col;
+
+			indices.push_back(ivec3(topLeft, topLeft + 1, topLeft + patchVertices));
+			indices.push_back(ivec3(topLeft + 1, topLeft + 1 + patchVertices, topLeft + patchVertices));
+		}
+	}
+
+	*indexCount = (int)indices.size() * 3;
+
+	VAO* patch = new VAO();
+	patch->bind();
+
+	patch->addBuffer(vertices.data(), (int)(vertices.size() * sizeof(VAO::VertexData)), VAO::VERTICES);
+	patch->addBuffer(indices.data(), (int)(indices.size() * sizeof(ivec3)), VAO::INDICES);
+
+	patch->enableAttribArrays(BUF_VERTICES);
+
+	patch->unbind();
+
+	return (patch);
+}
+
+// Works out the biome colour map - the same RGBA weights as the vertex
+// colours, as 8 bit values. Also used by TerrainDisplacement.
+void TerrainLOD::getBiomeColours(const vector<unsigned char>& biomeMap, vector<unsigned char>* colours)
+{
+	colours->resize(biomeMap.size() * 4);
+
+	for (int i = 0; i < biomeMap.size(); i++)
+	{
+		const float* weights = TerrainGenerator::biomeTable[biomeMap[i]].weights;
+
+		for (int c = 0; c < 4; c++)
+		{
+			(*colours)[i * 4 + c] = (unsigned char)(weights[c] * 255.0f + 0.5f);
+		}
+	}
+}
+
+// Creates a square texture of one value per vertex, clamped at the edges and
+// linearly filtered (so morphing vertices between grid points get
+// interpolated heights). pixels can be NULL to only allocate it. Also used by
+// TerrainDisplacement.
+GLuint TerrainLOD::createMapTexture(int gridSize, GLint internalFormat, GLenum format, GLenum type, const void* pixels)
+{
+	GLuint texture;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Rows of a 16 bit texture may not be a multiple of 4 bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, gridSize, gridSize, 0, format, type, pixels);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return (texture);
+}
+
+// Uploads the next rows of a map texture made by createMapTexture, as many
+// whole rows as fit in maxBytes. uploadedRows is how many are already done,
+// and is moved on. Returns the bytes uploaded. Also used by
+// TerrainDisplacement.
+int TerrainLOD::uploadMapRows(GLuint texture, int gridSize, GLenum format, GLenum type, int rowBytes, const void* pixels, int* uploadedRows, int maxBytes)
+{
+	int rows = std::min(gridSize - *uploadedRows, std::max(maxBytes, 0) / rowBytes);
+
+	if (rows <= 0)
+	{
+		return (0);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, *uploadedRows, gridSize, rows, format, type, (const char*)pixels + (size_t)*uploadedRows * rowBytes);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	*uploadedRows += rows;
+
+	return (rows * rowBytes);
+}
+
+// Points the terrain shader at the height/biome texture units, and gives it
+// the grid layout. Also used by TerrainDisplacement.
+void TerrainLOD::setMapUniforms(Shader* terrainShader, const TerrainConfig& cfg)
+{
+	terrainShader->use();
+	terrainShader->setInt("heightMap", MAP_HEIGHT_TEXTURE_SLOT);
+	terrainShader->setInt("biomeMap", MAP_BIOME_TEXTURE_SLOT);
+	terrainShader->setFloat("gridSize", (float)cfg.gridSize);
+	terrainShader->setFloat("verticeOffset", cfg.verticeOffset);
+	terrainShader->setFloat("startPos", cfg.getStartPos());
+	glUseProgram(0);
+}
+
+// Calculates the min/max height of every quadtree node, used for the node
+// bounding boxes. Full detail nodes are taken from the heights, and every
+// level above from its four children.
+void TerrainLOD::calcNodeHeights(const vector<float>& heightMap)
+{
+	nodeHeights.resize(numLevels);
+
+	int lastVertex = config.gridSize - 1;
+	int nodesPerSide = rootSize / LOD_PATCH_SIZE;
+
+	// Full detail - empty nodes (outside of the map) get min > max
+	nodeHeights[0].assign(nodesPerSide * nodesPerSide, vec2(1.0f, -1.0f));
+
+	for (int nodeRow = 0; nodeRow < nodesPerSide; nodeRow++)
+	{
+		for (int nodeCol = 0; nodeCol < nodesPerSide; nodeCol++)
+		{
+			int firstCol = nodeCol * LOD_PATCH_SIZE;
+			int firstRow = nodeRow * LOD_PATCH_SIZE;
+
+			if (firstCol >= lastVertex || firstRow >= lastVertex)
+			{
+				continue;
+			}
+
+			vec2 range = vec2(heightMap[firstRow * config.gridSize + firstCol]);
+
+			for (int row = firstRow; row <= std::min(firstRow + LOD_PATCH_SIZE, lastVertex); row++)
+			{
+				for (int col = firstCol; col <= std::min(firstCol + LOD_PATCH_SIZE, lastVertex); col++)
+				{
+					float h = heightMap[row * config.gridSize + col];
+
+					range.x = std::min(range.x, h);
+					range.y = std::max(range.y, h);
+				}
+			}
+
+			nodeHeights[0][nodeRow * nodesPerSide + nodeCol] = range;
+		}
+	}
+
+	for (int level = 1; level < numLevels; level++)
+	{
+		int childrenPerSide = nodesPerSide;
+		nodesPerSide /= 2;
+
+		nodeHeights[level].assign(nodesPerSide * nodesPerSide, vec2(1.0f, -1.0f));
+
+		for (int nodeRow = 0; nodeRow < nodesPerSide; nodeRow++)
+		{
+			for (int nodeCol = 0; nodeCol < nodesPerSide; nodeCol++)
+			{
+				vec2& range = nodeHeights[level][nodeRow * nodesPerSide + nodeCol];
+
+				for (int child = 0; child < 4; child++)
+				{
+					vec2 childRange = nodeHeights[level - 1][(nodeRow * 2 + child / 2) * childrenPerSide + nodeCol * 2 + child % 2];
+
+					// Skip empty children
+					if (childRange.x > childRange.y)
+					{
+						continue;
+					}
+
+					if (range.x > range.y)
+					{
+						range = childRange;
+					}
+					else
+					{
+						range.x = std::min(range.x, childRange.x);
+						range.y = std::max(range.y, childRange.y);
+					}
+				}
+			}
+		}
+	}
+}
+
+// Works out the max height error of each level, then the distance up to
+// which each level has to be used for the given screen height.
+void TerrainLOD::calcLevelRanges(const vector<float>& heightMap, float screenHeight)
+{
+	const int gridSize = config.gridSize;
+
+	// Max height error of each level against the full detail heights.
+	// A level skips vertices, so its error is how far the heights it skips
+	// are from the interpolation of the vertices it keeps.
+	levelErrors.assign(numLevels, 0.0f);
+
+	for (int level = 1; level < numLevels; level++)
+	{
+		int step = 1 << level;
+
+		vector<float> rowErrors(gridSize, 0.0f);
+
+		ThreadPool::getShared()->parallelFor(gridSize, [&](int row)
+		{
+			int row0 = (row / step) * step;
+			int row1 = std::min(row0 + step, gridSize - 1);
+			float tz = (row1 > row0) ? (float)(row - row0) / (row1 - row0) : 0.0f;
+
+			for (int col = 0; col < gridSize; col++)
+			{
+				int col0 = (col / step) * step;
+				int col1 = std::min(col0 + step, gridSize - 1);
+				float tx = (col1 > col0) ? (float)(col - col0) / (col1 - col0) : 0.0f;
+
+				float h00 = heightMap[row0 * gridSize + col0];
+				float h01 = heightMap[row0 * gridSize + col1];
+				float h10 = heightMap[row1 * gridSize + col0];
+				float h11 = heightMap[row1 * gridSize + col1];
+
+				float interpolated = mix(mix(h00, h01, tx), mix(h10, h11, tx), tz);
+
+				rowErrors[row] = std::max(rowErrors[row], (float)fabs(heightMap[row * gridSize + col] - interpolated));
+			}
+		});
+
+		levelErrors[level] = *max_element(rowErrors.begin(), rowErrors.end());
+	}
+
+	setScreenHeight(screenHeight);
+}
+
+// Works out the distance up to which each level has to be used, so that the
+// height error of the next level down never covers more than
+// LOD_MAX_PIXEL_ERROR pixels on a screen of the given height. Only uses the
+// level errors, so is cheap enough to call whenever the window is resized.
+void TerrainLOD::setScreenHeight(float screenHeight)
+{
+	// Pixels per world unit of height error at a distance of 1
+	float pixelsPerUnit = screenHeight / (2.0f * tan(radians(LOD_FIELD_OF_VIEW * 0.5f)));
+
+	levelRanges.resize(numLevels);
+
+	for (int level = 0; level < numLevels - 1; level++)
+	{
+		// Distance at which the next level's error shrinks to the max pixel error
+		float range = levelErrors[level + 1] * pixelsPerUnit / LOD_MAX_PIXEL_ERROR;
+
+		// Ranges must at least double each level, and be larger than the
+		// level's nodes, so neighbouring nodes are never more than one level apart
+		float nodeLength = (float)(LOD_PATCH_SIZE << level) * config.verticeOffset;
+
+		range = std::max(range, 2.0f * nodeLength);
+
+		if (level > 0)
+		{
+			range = std::max(range, 2.0f * levelRanges[level - 1]);
+		}
+
+		levelRanges[level] = range;
+	}
+
+	levelRanges[numLevels - 1] = LOD_UNLIMITED_RANGE;
+}
+
+// Gets the bounding box of a node, in terrain space.
+void TerrainLOD::getNodeBounds(int col, int row, int level, vec3* boxMin, vec3* boxMax)
+{
+	int size = LOD_PATCH_SIZE << level;
+	int lastVertex = config.gridSize - 1;
+
+	vec2 heights = nodeHeights[level][(row / size) * (rootSize / size) + col / size];
+
+	// x increases with column, z decreases with row
+	boxMin->x = config.getStartPos() + col * config.verticeOffset;
+	boxMax->x = config.getStartPos() + std::min(col + size, lastVertex) * config.verticeOffset;
+	boxMin->z = config.getStartPos() - std::min(row + size, lastVertex) * config.verticeOffset;
+	boxMax->z = config.getStartPos() - row * config.verticeOffset;
+	boxMin->y = heights.x;
+	boxMax->y = heights.y;
+}
+
+// Checks if any part of a box is within range of the camera.
+bool TerrainLOD::isInRange(vec3 cameraPos, vec3 boxMin, vec3 boxMax, float range)
+{
+	vec3 closest;
+	closest.x = glm::clamp(cameraPos.x, boxMin.x, boxMax.x);
+	closest.y = glm::clamp(cameraPos.y, boxMin.y, boxMax.y);
+	closest.z = glm::clamp(cameraPos.z, boxMin.z, boxMax.z);
+
+	vec3 diff = closest - cameraPos;
+
+	return (dot(diff, diff) <= range * range);
+}
+
+// Picks the nodes to draw under a given node. Returns false if the node is
+// too far away for its level, in which case its parent covers it instead.
+bool TerrainLOD::selectNode(int col, int row, int level, vec3 cameraPos, Frustum& frustum)
+{
+	int lastVertex = config.gridSize - 1;
+
+	// Nothing to draw outside of the map
+	if (col >= lastVertex || row >= lastVertex)
+	{
+		return (true);
+	}
+
+	vec3 boxMin, boxMax;
+	getNodeBounds(col, row, level, &boxMin, &boxMax);
+
+	if (!isInRange(cameraPos, boxMin, boxMax, levelRanges[level]))
+	{
+		return (false);
+	}
+
+	if (!frustum.isBoxVisible(boxMin, boxMax))
+	{
+		// Handled - just not visible
+		return (true);
+	}
+
+	Node node;
+
+	// Use this level if it is the most detailed, or no part of the node is
+	// close enough to need the next level down
+	if (level == 0 || !isInRange(cameraPos, boxMin, boxMax, levelRanges[level - 1]))
+	{
+		node.col = col;
+		node.row = row;
+		node.level = level;
+
+		selectedNodes.push_back(node);
+
+		return (true);
+	}
+
+	int half = (LOD_PATCH_SIZE << level) / 2;
+
+	for (int child = 0; child < 4; child++)
+	{
+		int childCol = col + (child % 2) * half;
+		int childRow = row + (child / 2) * half;
+
+		// Children out of their own range are drawn at their level but fully
+		// morphed, which gives the same shape as this level
+		if (!selectNode(childCol, childRow, level - 1, cameraPos, frustum))
+		{
+			node.col = childCol;
+			node.row = childRow;
+			node.level = level - 1;
+
+			selectedNodes.push_back(node);
+		}
+	}
+
+	return (true);
+}
+
+// Selects the nodes for this frame and draws them. The camera position and
+// MVP matrix are both in terrain space. Assumes the terrain textures are
+// already bound.
+void TerrainLOD::drawTerrain(vec3 cameraPos, mat4 mvpMatrix)
+{
+	Frustum frustum(mvpMatrix);
+
+	selectedNodes.clear();
+	selectNode(0, 0, numLevels - 1, cameraPos, frustum);
+
+	shaders->use();
+	shaders->setInt("renderMode", 1);
+	shaders->setVec3("lodCameraPos", cameraPos);
+
+	// Heights are stored unscaled
+	shaders->setFloat("heightScale", 1.0f);
+	shaders->setFloat("heightMin", 0.0f);
+
+	glActiveTexture(GL_TEXTURE0 + MAP_HEIGHT_TEXTURE_SLOT);
+	glBindTexture(GL_TEXTURE_2D, heightTexture);
+	glActiveTexture(GL_TEXTURE0 + MAP_BIOME_TEXTURE_SLOT);
+	glBindTexture(GL_TEXTURE_2D, biomeTexture);
+
+	patchVAO->bind();
+
+	for (int i = 0; i < selectedNodes.size(); i++)
+	{
+		float range = levelRanges[selectedNodes[i].level];
+
+		shaders->setVec2("nodeOffset", vec2((float)selectedNodes[i].col, (float)selectedNodes[i].row));
+		shaders->setFloat("nodeScale", (float)(1 << selectedNodes[i].level));
+		shaders->setVec2("morphRange", vec2(range * LOD_MORPH_START, range));
+
+		glDrawElements(GL_TRIANGLES, patchIndexCount, GL_UNSIGNED_INT, 0);
+	}
+
+	patchVAO->unbind();
+
+	drawnTriangles = (int)selectedNodes.size() * (patchIndexCount / 3);
+
+	shaders->setInt("renderMode", 0);
+}
@@ -0,0 +1,235 @@
+#include "..\h\TerrainNoise.h"
+
+#include <math.h>
+
+// SSE2 is available on every x64 target
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NOISE_SSE2
+#endif
+
+// Same hashing primes and Perlin scale as FastNoiseLite
+#define PERLIN_PRIME_X		501125321
+#define PERLIN_PRIME_Y		1136930381
+#define PERLIN_HASH			0x27d4eb2d
+#define PERLIN_SCALE		1.4247691104677813f
+
+// FastNoiseLite's 2D gradient table. Its first 24 gradients repeat to fill
+// 120 of its 128 entries, and the last 8 are diagonals.
+static const float baseGradients[48] =
+{
+	0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+	0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+	0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+	-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+	-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+	-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f
+};
+
+static const float extraGradients[16] =
+{
+	0.38268343236509f, 0.923879532511287f, 0.923879532511287f, 0.38268343236509f, 0.923879532511287f, -0.38268343236509f, 0.38268343236509f, -0.923879532511287f,
+	-0.38268343236509f, -0.923879532511287f, -0.923879532511287f, -0.38268343236509f, -0.923879532511287f, 0.38268343236509f, -0.38268343236509f, 0.923879532511287f
+};
+
+// The full table, x and y of each gradient side by side
+struct GradientTable
+{
+	float values[256];
+
+	GradientTable()
+	{
+		for (int i = 0; i < 240; i++)
+		{
+			values[i] = baseGradients[i % 48];
+		}
+
+		for (int i = 240; i < 256; i++)
+		{
+			values[i] = extraGradients[i - 240];
+		}
+	}
+};
+
+static const GradientTable gradients;
+
+// Index of the gradient at a lattice point - the same hash FastNoiseLite uses.
+// Unsigned so the multiply wraps, which only changes bits the index ignores.
+static inline int getGradientIndex(int seed, int xPrimed, int yPrimed)
+{
+	unsigned int hash = (unsigned int)(seed ^ xPrimed ^ yPrimed) * PERLIN_HASH;
+	hash ^= hash >> 15;
+
+	return ((int)(hash & (127 << 1)));
+}
+
+#ifdef NOISE_SSE2
+// Multiplies four 32 bit integers, keeping the low 32 bits of each
+// (_mm_mullo_epi32 needs SSE4.1)
+static inline __m128i multiply(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+	return (_mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))));
+}
+
+// getGradientIndex() for four lattice points at once
+static inline __m128i getGradientIndices(__m128i seeds, __m128i xPrimed, __m128i yPrimed)
+{
+	__m128i hash = multiply(_mm_xor_si128(_mm_xor_si128(seeds, xPrimed), yPrimed), _mm_set1_epi32(PERLIN_HASH));
+	hash = _mm_xor_si128(hash, _mm_srli_epi32(hash, 15));
+
+	return (_mm_and_si128(hash, _mm_set1_epi32(127 << 1)));
+}
+#endif
+
+// Sets up the height, pathway and model placement noise from the
+// terrain settings.
+TerrainNoise::TerrainNoise(const TerrainConfig& cfg)
+{
+	// Perlin noise for the height map (y axis) and the pathway map
+	terrainFrequency = cfg.terrainFrequency;
+	terrainSeed = cfg.getTerrainSeed();
+
+	pathFrequency = cfg.pathFrequency;
+	pathSeed = cfg.getPathSeed();
+
+	// OpenSimplex noise for model placement - OS seems to give more "extreme" values closer together -
+	// when tested on terrain, there were considerably more hills and troughs, with less in between values.
+	modelNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+	modelNoise.SetFrequency(cfg.modelFrequency);
+	modelNoise.SetSeed(cfg.getModelSeed());
+}
+
+// Gets all noise values for biome type, terrain height and model placement
+// at the given x/y coordinate (2D grid position)
+TerrainNoise::Sample TerrainNoise::getSample(float x, float y) const
+{
+	Sample s;
+
+	// Perlin noise for the 3 height octaves, then the pathway
+	float perlin[4];
+
+#ifdef NOISE_SSE2
+	// Each lane does exactly the same steps as FastNoiseLite's SinglePerlin
+	__m128 xs = _mm_mul_ps(_mm_setr_ps(x, 2 * x, 4 * x, x), _mm_setr_ps(terrainFrequency, terrainFrequency, terrainFrequency, pathFrequency));
+	__m128 ys = _mm_mul_ps(_mm_setr_ps(y, 2 * y, 4 * y, y), _mm_setr_ps(terrainFrequency, terrainFrequency, terrainFrequency, pathFrequency));
+	__m128i seeds = _mm_setr_epi32(terrainSeed, terrainSeed, terrainSeed, pathSeed);
+
+	// Floor - truncate, then step negative values down one
+	const __m128 zero = _mm_setzero_ps();
+	__m128i x0 = _mm_add_epi32(_mm_cvttps_epi32(xs), _mm_castps_si128(_mm_cmplt_ps(xs, zero)));
+	__m128i y0 = _mm_add_epi32(_mm_cvttps_epi32(ys), _mm_castps_si128(_mm_cmplt_ps(ys, zero)));
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128 xd0 = _mm_sub_ps(xs, _mm_cvtepi32_ps(x0));
+	__m128 yd0 = _mm_sub_ps(ys, _mm_cvtepi32_ps(y0));
+	__m128 xd1 = _mm_sub_ps(xd0, one);
+	__m128 yd1 = _mm_sub_ps(yd0, one);
+
+	// Quintic interpolation weights - t * t * t * (t * (t * 6 - 15) + 10)
+	const __m128 six = _mm_set1_ps(6.0f);
+	const __m128 fifteen = _mm_set1_ps(15.0f);
+	const __m128 ten = _mm_set1_ps(10.0f);
+	__m128 xWeight = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(xd0, xd0), xd0), _mm_add_ps(_mm_mul_ps(xd0, _mm_sub_ps(_mm_mul_ps(xd0, six), fifteen)), ten));
+	__m128 yWeight = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(yd0, yd0), yd0), _mm_add_ps(_mm_mul_ps(yd0, _mm_sub_ps(_mm_mul_ps(yd0, six), fifteen)), ten));
+
+	// Hash each corner of the lattice cell into a gradient index, four lanes at a time
+	__m128i xp0 = multiply(x0, _mm_set1_epi32(PERLIN_PRIME_X));
+	__m128i yp0 = multiply(y0, _mm_set1_epi32(PERLIN_PRIME_Y));
+	__m128i xp1 = _mm_add_epi32(xp0, _mm_set1_epi32(PERLIN_PRIME_X));
+	__m128i yp1 = _mm_add_epi32(yp0, _mm_set1_epi32(PERLIN_PRIME_Y));
+
+	int i00[4], i10[4], i01[4], i11[4];
+
+	_mm_storeu_si128((__m128i*)i00, getGradientIndices(seeds, xp0, yp0));
+	_mm_storeu_si128((__m128i*)i10, getGradientIndices(seeds, xp1, yp0));
+	_mm_storeu_si128((__m128i*)i01, getGradientIndices(seeds, xp0, yp1));
+	_mm_storeu_si128((__m128i*)i11, getGradientIndices(seeds, xp1, yp1));
+
+	// SSE2 has no gather, so the gradients are looked up one lane at a time
+	const float* g = gradients.values;
+
+	__m128 gx00 = _mm_setr_ps(g[i00[0]], g[i00[1]], g[i00[2]], g[i00[3]]);
+	__m128 gy00 = _mm_setr_ps(g[i00[0] + 1], g[i00[1] + 1], g[i00[2] + 1], g[i00[3] + 1]);
+	__m128 gx10 = _mm_setr_ps(g[i10[0]], g[i10[1]], g[i10[2]], g[i10[3]]);
+	__m128 gy10 = _mm_setr_ps(g[i10[0] + 1], g[i10[1] + 1], g[i10[2] + 1], g[i10[3] + 1]);
+	__m128 gx01 = _mm_setr_ps(g[i01[0]], g[i01[1]], g[i01[2]], g[i01[3]]);
+	__m128 gy01 = _mm_setr_ps(g[i01[0] + 1], g[i01[1] + 1], g[i01[2] + 1], g[i01[3] + 1]);
+	__m128 gx11 = _mm_setr_ps(g[i11[0]], g[i11[1]], g[i11[2]], g[i11[3]]);
+	__m128 gy11 = _mm_setr_ps(g[i11[0] + 1], g[i11[1] + 1], g[i11[2] + 1], g[i11[3] + 1]);
+
+	// Dot product of each corner's gradient with the offset to it
+	__m128 d00 = _mm_add_ps(_mm_mul_ps(xd0, gx00), _mm_mul_ps(yd0, gy00));
+	__m128 d10 = _mm_add_ps(_mm_mul_ps(xd1, gx10), _mm_mul_ps(yd0, gy10));
+	__m128 d01 = _mm_add_ps(_mm_mul_ps(xd0, gx01), _mm_mul_ps(yd1, gy01));
+	__m128 d11 = _mm_add_ps(_mm_mul_ps(xd1, gx11), _mm_mul_ps(yd1, gy11));
+
+	// Lerp - a + t * (b - a)
+	__m128 xf0 = _mm_add_ps(d00, _mm_mul_ps(xWeight, _mm_sub_ps(d10, d00)));
+	__m128 xf1 = _mm_add_ps(d01, _mm_mul_ps(xWeight, _mm_sub_ps(d11, d01)));
+	__m128 result = _mm_add_ps(xf0, _mm_mul_ps(yWeight, _mm_sub_ps(xf1, xf0)));
+
+	_mm_storeu_ps(perlin, _mm_mul_ps(result, _mm_set1_ps(PERLIN_SCALE)));
+#else
+	perlin[0] = getPerlin(terrainSeed, x * terrainFrequency, y * terrainFrequency);
+	perlin[1] = getPerlin(terrainSeed, (2 * x) * terrainFrequency, (2 * y) * terrainFrequency);
+	perlin[2] = getPerlin(terrainSeed, (4 * x) * terrainFrequency, (4 * y) * terrainFrequency);
+	perlin[3] = getPerlin(pathSeed, x * pathFrequency, y * pathFrequency);
+#endif
+
+	// Generate noise at 3 different frequencies for additional variation
+	s.terrain = 1 * perlin[0]
+		+ 0.5 * perlin[1]
+		+ 0.25 * perlin[2];
+
+	// Generate noise and get absolute value (turbulence).
+	// This produces a simple noise map that gives the impression of
+	// winding pathways
+	s.path = fabs(perlin[3]);
+
+	s.model = modelNoise.GetNoise(x, y); // Generate noise for model placement
+
+	// Divide by the sum of the 3 amplitudes to maintain values between 0-1
+	// Multiply by 2 for greater height diversity.
+	s.height = (s.terrain / (1 + 0.5 + 0.25)) * 2;
+
+	return (s);
+}
+
+// Perlin noise at an already scaled position, the same as FastNoiseLite's
+// SinglePerlin. Used where SSE2 is not available.
+float TerrainNoise::getPerlin(int seed, float x, float y)
+{
+	int x0 = x >= 0 ? (int)x : (int)x - 1;
+	int y0 = y >= 0 ? (int)y : (int)y - 1;
+
+	float xd0 = (float)(x - x0);
+	float yd0 = (float)(y - y0);
+	float xd1 = xd0 - 1;
+	float yd1 = yd0 - 1;
+
+	float xs = xd0 * xd0 * xd0 * (xd0 * (xd0 * 6 - 15) + 10);
+	float ys = yd0 * yd0 * yd0 * (yd0 * (yd0 * 6 - 15) + 10);
+
+	int xp0 = (int)((unsigned int)x0 * PERLIN_PRIME_X);
+	int yp0 = (int)((unsigned int)y0 * PERLIN_PRIME_Y);
+	int xp1 = (int)((unsigned int)xp0 + PERLIN_PRIME_X);
+	int yp1 = (int)((unsigned int)yp0 + PERLIN_PRIME_Y);
+
+	const float* g00 = gradients.values + getGradientIndex(seed, xp0, yp0);
+	const float* g10 = gradients.values + getGradientIndex(seed, xp1, yp0);
+	const float* g01 = gradients.values + getGradientIndex(seed, xp0, yp1);
+	const float* g11 = gradients.values + getGradientIndex(seed, xp1, yp1);
+
+	float d00 = xd0 * g00[0] + yd0 * g00[1];
+	float d10 = xd1 * g10[0] + yd0 * g10[1];
+	float d01 = xd0 * g01[0] + yd1 * g01[1];
+	float d11 = xd1 * g11[0] + yd1 * g11[1];
+
+	float xf0 = d00 + xs * (d10 - d00);
+	float xf1 = d01 + xs * (d11 - d01);
+
+	return ((xf0 + ys * (xf1 - xf0)) * PERLIN_SCALE);
+}
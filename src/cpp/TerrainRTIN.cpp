@@ -0,0 +1,230 @@
+#include "..\h\TerrainRTIN.h"
+#include "..\h\ThreadPool.h"
+#include "..\h\MeshOptimiser.h"
+
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <stdlib.h>
+
+// Works out the corners of every triangle in the hierarchy. Triangle i is
+// found by following the bits of i + 2 from the top: the lowest bit picks
+// one of the two halves of the tile, and each bit above it picks the left or
+// right half of the triangle before.
+TerrainRTIN::TerrainRTIN(const TerrainConfig& cfg, float maxError, bool optimiseCache)
+{
+	config = cfg;
+	this->maxError = maxError;
+	this->optimiseCache = optimiseCache;
+	buildMs = 0.0;
+
+	for (int i = 0; i < RTIN_TRIANGLES; i++)
+	{
+		int id = i + 2;
+		int ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+
+		if (id & 1)
+		{
+			// Bottom left half
+			bx = by = cx = RTIN_TILE_SIZE;
+		}
+		else
+		{
+			// Top right half
+			ax = ay = cy = RTIN_TILE_SIZE;
+		}
+
+		while ((id >>= 1) > 1)
+		{
+			int mx = (ax + bx) >> 1;
+			int my = (ay + by) >> 1;
+
+			if (id & 1)
+			{
+				// Left half
+				bx = ax;
+				by = ay;
+				ax = cx;
+				ay = cy;
+			}
+			else
+			{
+				// Right half
+				ax = bx;
+				ay = by;
+				bx = cx;
+				by = cy;
+			}
+
+			cx = mx;
+			cy = my;
+		}
+
+		triangleCorners[i * 4] = (unsigned char)ax;
+		triangleCorners[i * 4 + 1] = (unsigned char)ay;
+		triangleCorners[i * 4 + 2] = (unsigned char)bx;
+		triangleCorners[i * 4 + 3] = (unsigned char)by;
+	}
+}
+
+// Builds the mesh of every chunk, in parallel, into one list of triangles
+// (three indices each, into each chunk's own vertices). Chunk i's triangles
+// are from chunkStarts[i] to chunkStarts[i + 1].
+void TerrainRTIN::buildMesh(const TerrainGenerator* terrain, vector<unsigned short>* indices, vector<int>* chunkStarts)
+{
+	auto start = chrono::steady_clock::now();
+
+	const int chunks = config.getDrawChunks() * config.getDrawChunks();
+
+	vector<vector<unsigned short>> chunkIndices(chunks);
+
+	ThreadPool::getShared()->parallelFor(chunks, [&](int chunk)
+	{
+		buildChunk(terrain, chunk, &chunkIndices[chunk]);
+	});
+
+	chunkStarts->resize(chunks + 1);
+	(*chunkStarts)[0] = 0;
+
+	for (int chunk = 0; chunk < chunks; chunk++)
+	{
+		(*chunkStarts)[chunk + 1] = (*chunkStarts)[chunk] + (int)chunkIndices[chunk].size();
+	}
+
+	indices->resize((*chunkStarts)[chunks]);
+
+	ThreadPool::getShared()->parallelFor(chunks, [&](int chunk)
+	{
+		std::copy(chunkIndices[chunk].begin(), chunkIndices[chunk].end(), indices->begin() + (*chunkStarts)[chunk]);
+	});
+
+	buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Builds the mesh of one chunk from the current heights, replacing indices.
+void TerrainRTIN::buildChunk(const TerrainGenerator* terrain, int chunk, vector<unsigned short>* indices)
+{
+	const int chunks = config.getDrawChunks();
+	const int lastVertex = config.gridSize - 1;
+
+	int chunkRow = (chunk / chunks) * RTIN_TILE_SIZE;
+	int chunkCol = (chunk % chunks) * RTIN_TILE_SIZE;
+
+	// Chunks on the far edges run past the map - their vertices there are
+	// copies of the edge ones, and no triangles are made from them
+	int validRows = std::min(RTIN_TILE_SIZE, lastVertex - chunkRow);
+	int validCols = std::min(RTIN_TILE_SIZE, lastVertex - chunkCol);
+
+	float heights[RTIN_TILE_SIDE * RTIN_TILE_SIDE];
+	float errors[RTIN_TILE_SIDE * RTIN_TILE_SIDE];
+
+	for (int row = 0; row < RTIN_TILE_SIDE; row++)
+	{
+		int mapRow = std::min(chunkRow + row, lastVertex);
+
+		for (int col = 0; col < RTIN_TILE_SIDE; col++)
+		{
+			heights[row * RTIN_TILE_SIDE + col] = terrain->getMapHeight(mapRow * config.gridSize + std::min(chunkCol + col, lastVertex));
+		}
+	}
+
+	getErrors(heights, validCols, validRows, errors);
+
+	indices->clear();
+
+	addTriangle(errors, validCols, validRows, 0, 0, RTIN_TILE_SIZE, RTIN_TILE_SIZE, RTIN_TILE_SIZE, 0, indices);
+	addTriangle(errors, validCols, validRows, RTIN_TILE_SIZE, RTIN_TILE_SIZE, 0, 0, 0, RTIN_TILE_SIZE, indices);
+
+	if (optimiseCache)
+	{
+		MeshOptimiser::optimiseVertexCache(indices->data(), (int)indices->size(), RTIN_TILE_SIDE * RTIN_TILE_SIDE);
+	}
+}
+
+// Returns how long the last buildMesh took.
+double TerrainRTIN::getBuildMs()
+{
+	return (buildMs);
+}
+
+// Works out the error of every triangle's long edge midpoint - how far the
+// height there is from halfway between the edge's ends - smallest triangles
+// first, so each midpoint also takes the larger error of the two triangles
+// below it. Then if any triangle needs splitting, so does every triangle
+// above it. The edges of the tile (and of the map, and anything past it)
+// are given an infinite error, so they are always split to full detail.
+void TerrainRTIN::getErrors(const float* heights, int validCols, int validRows, float* errors)
+{
+	const int parentTriangles = RTIN_TRIANGLES - RTIN_TILE_SIZE * RTIN_TILE_SIZE;
+	const float edge = numeric_limits<float>::infinity();
+
+	for (int y = 0; y < RTIN_TILE_SIDE; y++)
+	{
+		for (int x = 0; x < RTIN_TILE_SIDE; x++)
+		{
+			bool onEdge = x == 0 || y == 0 || x >= validCols || y >= validRows;
+
+			errors[y * RTIN_TILE_SIDE + x] = onEdge ? edge : 0.0f;
+		}
+	}
+
+	for (int i = RTIN_TRIANGLES - 1; i >= 0; i--)
+	{
+		int ax = triangleCorners[i * 4];
+		int ay = triangleCorners[i * 4 + 1];
+		int bx = triangleCorners[i * 4 + 2];
+		int by = triangleCorners[i * 4 + 3];
+
+		int mx = (ax + bx) >> 1;
+		int my = (ay + by) >> 1;
+		int cx = mx + my - ay;
+		int cy = my + ax - mx;
+
+		int middle = my * RTIN_TILE_SIDE + mx;
+
+		float interpolated = (heights[ay * RTIN_TILE_SIDE + ax] + heights[by * RTIN_TILE_SIDE + bx]) / 2.0f;
+
+		errors[middle] = std::max(errors[middle], fabsf(interpolated - heights[middle]));
+
+		if (i < parentTriangles)
+		{
+			int left = ((ay + cy) >> 1) * RTIN_TILE_SIDE + ((ax + cx) >> 1);
+			int right = ((by + cy) >> 1) * RTIN_TILE_SIDE + ((bx + cx) >> 1);
+
+			errors[middle] = std::max(errors[middle], std::max(errors[left], errors[right]));
+		}
+	}
+}
+
+// Adds a triangle (a and b the ends of its long edge, c the right angle), or
+// its two halves if its error is too large. Triangles reaching past the
+// edge of the map always have an infinite error, so they are split down to
+// single quads, and those past the edge are left out.
+void TerrainRTIN::addTriangle(const float* errors, int validCols, int validRows, int ax, int ay, int bx, int by, int cx, int cy, vector<unsigned short>* indices)
+{
+	int mx = (ax + bx) >> 1;
+	int my = (ay + by) >> 1;
+
+	bool pastEdge = std::max(ax, std::max(bx, cx)) > validCols || std::max(ay, std::max(by, cy)) > validRows;
+	bool canSplit = abs(ax - cx) + abs(ay - cy) > 1;
+
+	if (canSplit && errors[my * RTIN_TILE_SIDE + mx] > maxError)
+	{
+		addTriangle(errors, validCols, validRows, cx, cy, ax, ay, mx, my, indices);
+		addTriangle(errors, validCols, validRows, bx, by, cx, cy, mx, my, indices);
+	}
+	else if (!pastEdge)
+	{
+		// Same winding as the full grid
+		if ((bx - ax) * (cy - ay) - (by - ay) * (cx - ax) > 0)
+		{
+			std::swap(bx, cx);
+			std::swap(by, cy);
+		}
+
+		indices->push_back((unsigned short)(ay * RTIN_TILE_SIDE + ax));
+		indices->push_back((unsigned short)(by * RTIN_TILE_SIDE + bx));
+		indices->push_back((unsigned short)(cy * RTIN_TILE_SIDE + cx));
+	}
+}
@@ -0,0 +1,370 @@
+#include "..\h\TerrainRegions.h"
+#include "..\h\ThreadPool.h"
+
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+
+// Running totals for the part of a region inside one block of rows
+struct RegionTotals
+{
+	int		id;
+	int		area;
+	double	colSum;
+	double	rowSum;
+	int		minCol, maxCol;
+	int		minRow, maxRow;
+	float	minHeight, maxHeight;
+};
+
+// Follows the parents up to the root of a vertex's set, pointing each vertex
+// passed at its grandparent on the way (path halving). Parents always have
+// lower indices than their children.
+static int findRoot(int* parents, int i)
+{
+	while (parents[i] != i)
+	{
+		parents[i] = parents[parents[i]];
+		i = parents[i];
+	}
+
+	return (i);
+}
+
+// Joins the sets of two vertices, under the lower of their two roots
+static void join(int* parents, int a, int b)
+{
+	a = findRoot(parents, a);
+	b = findRoot(parents, b);
+
+	if (a < b)
+	{
+		parents[b] = a;
+	}
+	else if (b < a)
+	{
+		parents[a] = b;
+	}
+}
+
+// Labels the regions of a terrain's biome map, and measures each one (with
+// the heights for their bounds).
+TerrainRegions::TerrainRegions(const TerrainConfig& cfg, const vector<unsigned char>& biomeMap, const vector<float>& heightMap)
+{
+	gridSize = cfg.gridSize;
+	verticeOffset = cfg.verticeOffset;
+	startPos = cfg.getStartPos();
+
+	auto start = chrono::steady_clock::now();
+
+	label(biomeMap.data());
+	measure(heightMap.data());
+
+	labelMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Gives each vertex the ID of its region, in four steps:
+//  1. Each block of rows is joined up on its own, in parallel - parents
+//     never leave the block, so the blocks do not touch. Each vertex is then
+//     pointed straight at its root, and the block's roots are listed.
+//  2. The first row of each block is joined to the last row of the block
+//     before it. Only the roots change.
+//  3. The roots are given region IDs in order. A root joined to an earlier
+//     one takes its ID. IDs are stored as -(ID + 2), to tell them apart from
+//     parents (>= 0) and vertices in no region (-1).
+//  4. Every other vertex takes the ID of its root, in parallel - they only
+//     read the roots, which are decoded last.
+void TerrainRegions::label(const unsigned char* biomes)
+{
+	const int mapSize = gridSize * gridSize;
+
+	labels.resize(mapSize);
+	regions.clear();
+
+	int* parents = labels.data();
+
+	// Region type of each biome
+	unsigned char types[TerrainGenerator::BIOME_COUNT];
+
+	for (int biome = 0; biome < TerrainGenerator::BIOME_COUNT; biome++)
+	{
+		types[biome] = (unsigned char)TerrainGenerator::biomeTable[biome].region;
+	}
+
+	int blockRows = GEN_BLOCK_BYTES / (gridSize * sizeof(int));
+
+	if (blockRows < 1)
+	{
+		blockRows = 1;
+	}
+
+	int numBlocks = (gridSize + blockRows - 1) / blockRows;
+
+	vector<vector<int>> blockRoots(numBlocks);
+
+	ThreadPool::getShared()->parallelFor(numBlocks, [&](int block)
+	{
+		int blockStart = block * blockRows * gridSize;
+		int blockEnd = std::min((block + 1) * blockRows, gridSize) * gridSize;
+
+		for (int i = blockStart; i < blockEnd; i++)
+		{
+			int type = types[biomes[i]];
+
+			if (type == TerrainGenerator::REGION_NONE)
+			{
+				parents[i] = -1;
+				continue;
+			}
+
+			bool left = i % gridSize > 0 && types[biomes[i - 1]] == type;
+			bool up = i - gridSize >= blockStart && types[biomes[i - gridSize]] == type;
+
+			// Joined to the vertex to the left by sharing its parent. The one
+			// above is already in the same set if the one above-left joins them.
+			parents[i] = left ? parents[i - 1] : i;
+
+			if (up && !(left && types[biomes[i - gridSize - 1]] == type))
+			{
+				join(parents, i, i - gridSize);
+			}
+		}
+
+		// Parents come before their children, so one pass in order points
+		// every vertex at its root
+		for (int i = blockStart; i < blockEnd; i++)
+		{
+			if (parents[i] == i)
+			{
+				blockRoots[block].push_back(i);
+			}
+			else if (parents[i] >= 0)
+			{
+				parents[i] = parents[parents[i]];
+			}
+		}
+	});
+
+	for (int block = 1; block < numBlocks; block++)
+	{
+		int first = block * blockRows * gridSize;
+
+		for (int i = first; i < first + gridSize; i++)
+		{
+			if (parents[i] >= 0 && types[biomes[i]] == types[biomes[i - gridSize]])
+			{
+				join(parents, i, i - gridSize);
+			}
+		}
+	}
+
+	// A root's parent is always an earlier root, so it has already been
+	// given its ID
+	for (int block = 0; block < numBlocks; block++)
+	{
+		for (int root : blockRoots[block])
+		{
+			if (parents[root] == root)
+			{
+				Region region;
+				region.type = (TerrainGenerator::RegionType)types[biomes[root]];
+
+				parents[root] = -((int)regions.size() + 2);
+				regions.push_back(region);
+			}
+			else
+			{
+				parents[root] = parents[parents[root]];
+			}
+		}
+	}
+
+	ThreadPool::getShared()->parallelFor(numBlocks, [&](int block)
+	{
+		int blockStart = block * blockRows * gridSize;
+		int blockEnd = std::min((block + 1) * blockRows, gridSize) * gridSize;
+
+		for (int i = blockStart; i < blockEnd; i++)
+		{
+			if (parents[i] >= 0)
+			{
+				parents[i] = -parents[parents[i]] - 2;
+			}
+		}
+	});
+
+	for (int block = 0; block < numBlocks; block++)
+	{
+		for (int root : blockRoots[block])
+		{
+			parents[root] = -parents[root] - 2;
+		}
+	}
+}
+
+// Works out the area, centroid and bounds of each region. Each block of
+// rows totals up the regions in it in parallel, then the blocks' totals are
+// added up in order.
+void TerrainRegions::measure(const float* heights)
+{
+	int blockRows = GEN_BLOCK_BYTES / (gridSize * sizeof(int));
+
+	if (blockRows < 1)
+	{
+		blockRows = 1;
+	}
+
+	int numBlocks = (gridSize + blockRows - 1) / blockRows;
+
+	vector<vector<RegionTotals>> blockTotals(numBlocks);
+
+	ThreadPool::getShared()->parallelFor(numBlocks, [&](int block)
+	{
+		int firstRow = block * blockRows;
+		int endRow = std::min(firstRow + blockRows, gridSize);
+
+		// Where each region is in this block's totals. Regions come in runs
+		// along a row, so the last one is kept to hand.
+		unordered_map<int, int> slots;
+		vector<RegionTotals>& totals = blockTotals[block];
+
+		int lastId = -1;
+		int lastSlot = 0;
+
+		for (int row = firstRow; row < endRow; row++)
+		{
+			for (int col = 0; col < gridSize; col++)
+			{
+				int i = row * gridSize + col;
+				int id = labels[i];
+
+				if (id < 0)
+				{
+					continue;
+				}
+
+				float height = heights[i];
+
+				if (id != lastId)
+				{
+					auto slot = slots.find(id);
+
+					if (slot == slots.end())
+					{
+						RegionTotals region = { id, 0, 0.0, 0.0, col, col, row, row, height, height };
+
+						slot = slots.insert(make_pair(id, (int)totals.size())).first;
+						totals.push_back(region);
+					}
+
+					lastId = id;
+					lastSlot = slot->second;
+				}
+
+				RegionTotals& region = totals[lastSlot];
+
+				region.area++;
+				region.colSum += col;
+				region.rowSum += row;
+				region.minCol = std::min(region.minCol, col);
+				region.maxCol = std::max(region.maxCol, col);
+				region.maxRow = row;
+				region.minHeight = std::min(region.minHeight, height);
+				region.maxHeight = std::max(region.maxHeight, height);
+			}
+		}
+	});
+
+	vector<RegionTotals> totals(regions.size());
+
+	for (int i = 0; i < totals.size(); i++)
+	{
+		totals[i].area = 0;
+	}
+
+	for (int block = 0; block < numBlocks; block++)
+	{
+		for (const RegionTotals& part : blockTotals[block])
+		{
+			RegionTotals& region = totals[part.id];
+
+			if (region.area == 0)
+			{
+				region = part;
+				continue;
+			}
+
+			region.area += part.area;
+			region.colSum += part.colSum;
+			region.rowSum += part.rowSum;
+			region.minCol = std::min(region.minCol, part.minCol);
+			region.maxCol = std::max(region.maxCol, part.maxCol);
+			region.maxRow = part.maxRow;
+			region.minHeight = std::min(region.minHeight, part.minHeight);
+			region.maxHeight = std::max(region.maxHeight, part.maxHeight);
+		}
+	}
+
+	// Rows are generated front to back, so z decreases with each row
+	for (int i = 0; i < regions.size(); i++)
+	{
+		const RegionTotals& region = totals[i];
+
+		regions[i].area = region.area;
+		regions[i].centroid = vec2(startPos + (float)(region.colSum / region.area) * verticeOffset,
+			startPos - (float)(region.rowSum / region.area) * verticeOffset);
+		regions[i].minBounds = vec3(startPos + region.minCol * verticeOffset, region.minHeight, startPos - region.maxRow * verticeOffset);
+		regions[i].maxBounds = vec3(startPos + region.maxCol * verticeOffset, region.maxHeight, startPos - region.minRow * verticeOffset);
+	}
+}
+
+// Returns every region, indexed by region ID.
+const vector<TerrainRegions::Region>& TerrainRegions::getRegions() const
+{
+	return (regions);
+}
+
+// Returns the ID of the region a vertex (row * gridSize + col) is in, or -1
+// if it is in none.
+int TerrainRegions::getRegion(int vertex) const
+{
+	return (labels[vertex]);
+}
+
+// Returns the ID of the largest region of a type, or -1 if there are none.
+int TerrainRegions::getLargestRegion(TerrainGenerator::RegionType type) const
+{
+	int largest = -1;
+
+	for (int i = 0; i < regions.size(); i++)
+	{
+		if (regions[i].type == type && (largest < 0 || regions[i].area > regions[largest].area))
+		{
+			largest = i;
+		}
+	}
+
+	return (largest);
+}
+
+// Returns how many regions there are of a type.
+int TerrainRegions::getRegionCount(TerrainGenerator::RegionType type) const
+{
+	int count = 0;
+
+	for (int i = 0; i < regions.size(); i++)
+	{
+		if (regions[i].type == type)
+		{
+			count++;
+		}
+	}
+
+	return (count);
+}
+
+// Returns how long labelling and measuring the regions took.
+double TerrainRegions::getLabelMs() const
+{
+	return (labelMs);
+}
@@ -0,0 +1,161 @@
+#include "..\h\ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+
+// Creates the worker threads. If no thread count is given, one worker
+// is created per hardware thread.
+ThreadPool::ThreadPool(int numThreads)
+{
+	stopping = false;
+
+	if (numThreads <= 0)
+	{
+		numThreads = (int)thread::hardware_concurrency();
+	}
+
+	// hardware_concurrency() may return 0 if it can't be determined
+	if (numThreads <= 0)
+	{
+		numThreads = 1;
+	}
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		workers.push_back(thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(queueLock);
+		stopping = true;
+	}
+
+	queueSignal.notify_all();
+
+	for (int i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+// Returns the pool shared by the whole program. It is created on first use.
+ThreadPool* ThreadPool::getShared()
+{
+	static ThreadPool sharedPool;
+
+	return (&sharedPool);
+}
+
+int ThreadPool::getThreadCount()
+{
+	return ((int)workers.size());
+}
+
+// Queues a task to be run on the next available worker.
+void ThreadPool::submit(function<void()> task)
+{
+	{
+		lock_guard<mutex> lock(queueLock);
+		tasks.push_back(task);
+	}
+
+	queueSignal.notify_one();
+}
+
+// Runs fn(block) for every block in [0, numBlocks) across the pool and
+// waits for all of them to finish. Blocks are handed out one at a time,
+// so uneven blocks still balance out. The calling thread also takes
+// blocks, so this is safe to call from inside another pool task.
+void ThreadPool::parallelFor(int numBlocks, function<void(int block)> fn)
+{
+	struct ForState
+	{
+		atomic<int>			nextBlock;
+		int					finished;
+		mutex				doneLock;
+		condition_variable	doneSignal;
+	};
+
+	if (numBlocks <= 0)
+	{
+		return;
+	}
+
+	shared_ptr<ForState> state = make_shared<ForState>();
+	state->nextBlock = 0;
+	state->finished = 0;
+
+	int total = numBlocks;
+
+	// Each runner keeps taking blocks until none are left
+	function<void()> runner = [state, fn, total]()
+	{
+		int block = state->nextBlock++;
+
+		while (block < total)
+		{
+			fn(block);
+
+			bool allDone = false;
+
+			{
+				lock_guard<mutex> lock(state->doneLock);
+				state->finished++;
+				allDone = (state->finished == total);
+			}
+
+			if (allDone)
+			{
+				state->doneSignal.notify_all();
+			}
+
+			block = state->nextBlock++;
+		}
+	};
+
+	// No point waking more workers than there are blocks
+	int helpers = (int)workers.size();
+
+	if (helpers > numBlocks - 1)
+	{
+		helpers = numBlocks - 1;
+	}
+
+	for (int i = 0; i < helpers; i++)
+	{
+		submit(runner);
+	}
+
+	runner();
+
+	unique_lock<mutex> lock(state->doneLock);
+	state->doneSignal.wait(lock, [state, total]() { return (state->finished == total); });
+}
+
+// Main loop for each worker - waits for tasks and runs them until
+// the pool is destroyed.
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		function<void()> task;
+
+		{
+			unique_lock<mutex> lock(queueLock);
+			queueSignal.wait(lock, [this]() { return (stopping || !tasks.empty()); });
+
+			if (stopping && tasks.empty())
+			{
+				return;
+			}
+
+			task = tasks.front();
+			tasks.pop_front();
+		}
+
+		task();
+	}
+}
@@ -36,9 +36,97 @@ const string lFragShader = "shaders/lightShader.frag";
 // Create camera
 Camera* camera = NULL;
 
-int main()
+// Created in main - kept here so the resize callback can reach it
+Terrain* terrain = NULL;
+
+int main(int argc, char** argv)
 {
-	srand(time((time_t*)NULL)); // seed rand() with the time to improve the "true" randomness
+	// Terrain settings - map size can be changed on the command line
+	// with --size <vertices per side>. --stream streams chunks in around
+	// the camera instead of drawing a fixed map, and --lod draws the map
+	// with distance-based level of detail. --gpu draws the map from height
+	// and biome textures instead of a mesh, and --packed uploads the mesh
+	// with compact vertices. --seed <n> always generates the
+	// same world, and caches it on disk so later runs can load it.
+	// --erosion <iterations> erodes the generated heights, and
+	// --erosion-seed <n> picks a different erosion of the same world.
+	// --keep-mesh keeps the CPU copy of the mesh after it is uploaded, and
+	// --half-heights keeps the height map as 16 bit floats, and
+	// --adaptive <error> draws an adaptive mesh within that height error.
+	TerrainConfig terrainConfig;
+	bool lodTerrain = false;
+	bool fixedSeed = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+
+		if (arg == "--size" && i + 1 < argc)
+		{
+			terrainConfig.gridSize = atoi(argv[++i]);
+		}
+		else if (arg == "--stream")
+		{
+			terrainConfig.streamChunks = true;
+		}
+		else if (arg == "--lod")
+		{
+			lodTerrain = true;
+		}
+		else if (arg == "--gpu")
+		{
+			terrainConfig.displaceOnGPU = true;
+		}
+		else if (arg == "--packed")
+		{
+			terrainConfig.packVertices = true;
+		}
+		else if (arg == "--keep-mesh")
+		{
+			terrainConfig.keepMesh = true;
+		}
+		else if (arg == "--half-heights")
+		{
+			terrainConfig.halfHeights = true;
+		}
+		else if (arg == "--adaptive" && i + 1 < argc)
+		{
+			terrainConfig.meshError = (float)atof(argv[++i]);
+		}
+		else if (arg == "--seed" && i + 1 < argc)
+		{
+			terrainConfig.worldSeed = (unsigned int)strtoul(argv[++i], NULL, 10);
+			fixedSeed = true;
+		}
+		else if (arg == "--erosion" && i + 1 < argc)
+		{
+			terrainConfig.erosionIterations = atoi(argv[++i]);
+		}
+		else if (arg == "--erosion-seed" && i + 1 < argc)
+		{
+			terrainConfig.erosionSeed = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}
+	}
+
+	if (terrainConfig.gridSize < 2)
+	{
+		cout << "ERROR: Map size must be at least 2\n";
+		return -1;
+	}
+
+	// Only worlds with a chosen seed are cached - a new world is generated
+	// from the time on every other run, so its cache would never be used
+	if (fixedSeed)
+	{
+		terrainConfig.useCache = true;
+	}
+	else
+	{
+		terrainConfig.worldSeed = (unsigned int)time((time_t*)NULL);
+	}
+
+	// Print the seed so this world can be generated again with --seed
+	cout << "World seed: " << terrainConfig.worldSeed << "\n";
 
 	// Create and set up GLFW window
 	Display* d = new Display(mouseCallback, frameBufferSizeCallback);
@@ -54,7 +142,7 @@ int main()
 
 	// Add terrain, light and models.
 	// Close the program (-1) if shaders cannot be loaded.
-	Terrain* terrain = new Terrain(tVertexShader, tFragShader, &shaderError);
+	terrain = new Terrain(terrainConfig, tVertexShader, tFragShader, &shaderError);
 
 	if (shaderError)
 	{
@@ -62,7 +150,17 @@ int main()
 		return -1;
 	}
 
-	Light* light = new Light(lVertexShader, lFragShader, &shaderError);
+	if (lodTerrain && !terrainConfig.streamChunks)
+	{
+		// Errors are measured in framebuffer pixels - kept up to date in
+		// frameBufferSizeCallback
+		int width, height;
+
+		glfwGetFramebufferSize(d->getWindow(), &width, &height);
+		terrain->enableLOD((float)height);
+	}
+
+	Light* light = new Light(terrain, lVertexShader, lFragShader, &shaderError);
 
 	if (shaderError)
 	{
@@ -92,6 +190,9 @@ int main()
 
 	MVP* mvp = new MVP(); // Create MVP matrix
 
+	// Last time the terrain stats were shown in the window title
+	float lastStatsTime = 0.0f;
+
 	while (!glfwWindowShouldClose(d->getWindow()))
 	{
 		/////////////////////////////////////////////////////////////////////////////////////
@@ -126,6 +227,9 @@ int main()
 
 		mvp->updateView(camInfo.cameraPos, camInfo.cameraPos + camInfo.cameraFront, camInfo.cameraUp);
 
+		// Load in any streamed terrain chunks around the camera
+		terrain->updateStreaming(camInfo.cameraPos);
+
 		mvp->setProjection();
 
 		// Set up model
@@ -141,6 +245,17 @@ int main()
 		// Draw terrain
 		terrain->drawTerrain();
 
+		// Show how much of the terrain is being drawn, once a second
+		if (currFrame - lastStatsTime >= 1.0f)
+		{
+			string title = "Desert - " + to_string(terrain->getDrawnTriangles()) + " terrain triangles drawn, "
+				+ to_string(terrain->getCulledTriangles()) + " culled";
+
+			glfwSetWindowTitle(d->getWindow(), title.c_str());
+
+			lastStatsTime = currFrame;
+		}
+
 		/////////////////////////////////////////////////////////////////////////////////////
 		// *** Draw Models *** //
 		// ------------------- //
@@ -213,4 +328,10 @@ void mouseCallback(GLFWwindow* pW, double x, double y)
 void frameBufferSizeCallback(GLFWwindow* pW, int width, int height)
 {
 	glViewport(0, 0, width, height);
+
+	// Minimised windows have no height
+	if (terrain != NULL && height > 0)
+	{
+		terrain->setScreenHeight((float)height);
+	}
 }
\ No newline at end of file
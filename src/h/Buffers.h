@@ -9,10 +9,13 @@
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "VertexData.h"
+
 #define BUF_VERTICES	1
 #define BUF_NORMALS		2
 #define BUF_TEXTURES	4
 #define BUF_COLOURS		8
+#define BUF_PACKED		16	// Use the PackedVertexData layout for the enabled arrays
 
 using namespace glm;
 
@@ -33,6 +36,8 @@ protected:
 	void bind();
 	void unbind();
 
+	void update(const void* pData, int offset, int size);
+
 	friend VAO;
 };
 
@@ -46,6 +51,8 @@ protected:
 	IBO(const void* pData, int size);
 	~IBO();
 
+	void replace(const void* pData, int size);
+
 	friend VAO;
 };
 
@@ -54,12 +61,17 @@ class VAO
 {
 public:
 	// Structure that stores all data for a given vertex
-	struct VertexData
+	typedef ::VertexData VertexData;
+
+	// Compact terrain vertex, 12 bytes instead of 48. Used with BUF_PACKED -
+	// x/z and texture coordinates are worked out from the vertex index in
+	// the shader, so only the height is stored.
+	struct PackedVertexData
 	{
-		vec3 vertices;
-		vec4 colours;
-		vec3 normals;
-		vec2 textures;
+		short			normals[2];		// Octahedral encoded normal, 16 bit signed normalised
+		unsigned char	colours[4];		// Biome weights, 8 bit normalised
+		unsigned short	height;			// 16 bit normalised, over the height range given when packing
+		unsigned short	padding;		// Keeps each vertex 4 byte aligned
 	};
 
 	// Indicates the type of data a buffer will store
@@ -74,6 +86,11 @@ public:
 	void enableAttribArrays(int data);
 
 	void addBuffer(const void* pData, int size, BufferType type);
+	void updateVertices(const void* pData, int offset, int size);
+	void replaceIndices(const void* pData, int size);
+	void shareIndices(const VAO* owner);
+
+	static PackedVertexData packVertex(const VertexData& vertex, float heightMin, float heightScale);
 
 private:
 	GLuint vaoId;
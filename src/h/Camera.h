@@ -8,6 +8,11 @@
 // along the floor in walking mode
 #define USER_HEIGHT 1.0f
 
+// Terrain editing brush - placed on the ground this far in front of the camera
+#define EDIT_DISTANCE	3.0f
+#define EDIT_RADIUS		1.0f
+#define EDIT_SPEED		1.0f	// Height raised/lowered per second at the centre of the brush
+
 // irrKlang - audio
 #include <irrKlang/irrKlang.h>
 
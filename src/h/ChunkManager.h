@@ -0,0 +1,89 @@
+#ifndef CHUNKMANAGER_H
+
+#define CHUNKMANAGER_H
+
+#include "Buffers.h" // Includes GLM
+#include "TerrainConfig.h"
+#include "TerrainNoise.h"
+#include "TerrainGenerator.h"
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#define CHUNK_VERTICES				65						// Vertices along each side of a streamed chunk (64 quads)
+#define STREAM_RADIUS				8						// Chunks kept loaded in each direction around the camera
+#define STREAM_MEMORY_BUDGET		(128 * 1024 * 1024)		// Max GPU memory used by loaded chunks, in bytes
+#define CHUNK_UPLOADS_PER_FRAME		4						// Max finished chunks uploaded to the GPU each frame
+
+using namespace std;
+using namespace glm;
+
+// Streams the terrain in as fixed-size square chunks around the camera.
+// Chunks are generated on the shared thread pool and uploaded a few per
+// frame, so the world has no edge and the render loop never waits on
+// generation. Chunks that fall out of range are freed.
+class ChunkManager
+{
+public:
+	ChunkManager(const TerrainConfig& cfg);
+	~ChunkManager();
+
+	void update(vec3 cameraPos);
+	void drawChunks();
+
+	int getLoadedChunks();
+	void getSamples(const float* x, const float* z, int count, float* heights, vec3* normals, TerrainGenerator::Biome* biomes);
+
+private:
+	// A chunk that has been uploaded to the GPU
+	struct Chunk
+	{
+		int chunkX;
+		int chunkZ;
+		VAO* vao;
+	};
+
+	// A chunk that has been generated but not uploaded yet
+	struct ChunkData
+	{
+		int chunkX;
+		int chunkZ;
+		vector<VAO::VertexData> vertices;
+	};
+
+	TerrainConfig	config;
+	TerrainNoise	noise;
+
+	// Indices are the same for every chunk - one 16 bit pattern, uploaded
+	// once to indexVAO and shared by every chunk's VAO
+	vector<GLushort>	chunkIndices;
+	VAO*				indexVAO;
+
+	map<pair<int, int>, Chunk>	loadedChunks;
+	set<pair<int, int>>			pendingChunks;	// Queued or being generated
+
+	deque<ChunkData*>			readyChunks;	// Generated, waiting for upload
+	mutex						readyLock;
+
+	int							tasksInFlight;
+	atomic<bool>				stopping;
+	condition_variable			tasksSignal;
+
+	int							maxChunks;
+
+	void generateIndices();
+	ChunkData* generateChunk(int chunkX, int chunkZ);
+	void uploadChunk(ChunkData* data);
+	void requestChunk(int chunkX, int chunkZ);
+	void evictChunk(pair<int, int> key);
+
+	pair<int, int> getChunkAt(vec3 pos);
+	int getChunkDistance(pair<int, int> a, pair<int, int> b);
+};
+
+#endif
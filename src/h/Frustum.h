@@ -0,0 +1,29 @@
+#ifndef FRUSTUM_H
+
+#define FRUSTUM_H
+
+//GLM
+#include "glm/ext/vector_float3.hpp"
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#define NUM_PLANES	6
+
+using namespace glm;
+
+// View frustum taken from a combined projection * view * model matrix.
+// Used to skip drawing anything that is entirely off-screen.
+class Frustum
+{
+public:
+	Frustum();
+	Frustum(mat4 mvpMatrix);
+
+	bool isBoxVisible(vec3 boxMin, vec3 boxMax);
+
+private:
+	// Each plane is stored as (normal, distance), with normals facing inwards
+	vec4 planes[NUM_PLANES];
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef HEIGHTFIELD_H
+
+#define HEIGHTFIELD_H
+
+#include "TerrainGenerator.h"
+
+#include <vector>
+
+using namespace std;
+
+// Looks up the height and biome under any x/z position directly from the
+// terrain's height and biome maps (grids of one value per vertex), instead
+// of searching the vertex list. Used for walking on the terrain. The maps
+// are read in place (as floats or half floats), so edits to the terrain
+// show up straight away.
+// All positions are in terrain space (world position - TERRAIN_START).
+// Uses no OpenGL, so it also works on a TerrainGenerator on its own.
+class HeightField
+{
+public:
+	HeightField(const TerrainConfig& cfg, const TerrainGenerator* terrain);
+
+	float getHeight(float x, float z);
+	TerrainGenerator::Biome getBiome(float x, float z);
+	float getWaterDistance(float x, float z);
+	bool isInside(float x, float z);
+
+	void getSamples(const float* x, const float* z, int count, float* heights, vec3* normals, TerrainGenerator::Biome* biomes);
+
+private:
+	int		gridSize;
+	float	verticeOffset;
+
+	// Terrain space bounds of the grid
+	float	minX, maxX;
+	float	minZ, maxZ;
+
+	// Terrain holding the height and biome maps - one value per vertex, row by row
+	const TerrainGenerator*	maps;
+
+	void getGridPos(float x, float z, float* col, float* row);
+	void getSample(float x, float z, float* height, vec3* normal, TerrainGenerator::Biome* biome);
+};
+
+#endif
@@ -28,11 +28,16 @@ class Light : public ShaderInterface
 public:
 	vec3 lightColour;
 
-	Light(string vertexShader, string fragShader, int* err) : ShaderInterface(vertexShader, fragShader, err)
+	Light(Terrain* t, string vertexShader, string fragShader, int* err) : ShaderInterface(vertexShader, fragShader, err)
 	{
+		// Orbit the light around the terrain, whatever size it is
+		startPos = t->getConfig().getStartPos();
+		endPos = t->getConfig().getEndPos();
+		middlePos = t->getConfig().getMiddlePos();
+
 		currSkyColour = day1;
 		lightColour = vec3(1.0f);
-		lightPos = vec3(MIDDLE_POS, MIDDLE_POS, -MIDDLE_POS);
+		lightPos = vec3(middlePos, middlePos, -middlePos);
 
 		createLightVAO();
 
@@ -142,6 +147,11 @@ private:
 
 	// Holds the current light position
 	vec3 lightPos;
+
+	// Terrain positions (x & z axes) the light orbits around
+	float startPos;
+	float endPos;
+	float middlePos;
 };
 
 #endif
\ No newline at end of file
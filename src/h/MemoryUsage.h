@@ -0,0 +1,17 @@
+#ifndef MEMORYUSAGE_H
+
+#define MEMORYUSAGE_H
+
+#include <cstddef>
+
+// Reports how much memory the process is using, for the memory reports
+// printed at startup.
+class MemoryUsage
+{
+public:
+	// Bytes of the process currently resident in physical memory (the
+	// working set on Windows), or 0 if it cannot be found
+	static size_t getResidentBytes();
+};
+
+#endif
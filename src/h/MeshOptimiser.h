@@ -0,0 +1,63 @@
+#ifndef MESHOPTIMISER_H
+
+#define MESHOPTIMISER_H
+
+#include <vector>
+
+#define MESH_CACHE_SIZE		32	// Entries in the (LRU) vertex cache the triangle order is scored against
+#define MESH_FIFO_SIZE		16	// Entries in the (FIFO) vertex cache simulated to measure an order
+
+using namespace std;
+
+// Reorders indexed triangle lists to suit the GPU, without changing what is
+// drawn:
+//  - Vertex cache - triangles are ordered so each reuses the vertices of the
+//    ones just before it, which are still in the post-transform cache
+//    (Forsyth's linear-speed vertex cache optimisation).
+//  - Overdraw - runs of triangles that start with an empty cache are
+//    reordered so those facing out from the middle of the mesh, which are
+//    likely to hide the rest, are drawn first.
+//  - Vertex fetch - vertices are renumbered in the order they are first
+//    used, so they are read from memory in order.
+// The cache use of an order is measured as the ACMR (vertices transformed
+// per triangle, 0.5 at best for a large grid, 3 at worst) and the ATVR
+// (vertices transformed per vertex used, 1 at best).
+class MeshOptimiser
+{
+public:
+	// Cache use of one or more index lists
+	struct CacheStats
+	{
+		int		triangles;
+		int		vertices;		// Vertices used by the triangles
+		int		transformed;	// Cache misses
+
+		float getACMR() const
+		{
+			return (triangles > 0 ? (float)transformed / triangles : 0.0f);
+		}
+
+		float getATVR() const
+		{
+			return (vertices > 0 ? (float)transformed / vertices : 0.0f);
+		}
+
+		void add(const CacheStats& other)
+		{
+			triangles += other.triangles;
+			vertices += other.vertices;
+			transformed += other.transformed;
+		}
+	};
+
+	static CacheStats analyseVertexCache(const unsigned short* indices, int indexCount, int vertexCount);
+	static CacheStats analyseVertexCache(const unsigned int* indices, int indexCount, int vertexCount);
+
+	static void optimiseVertexCache(unsigned short* indices, int indexCount, int vertexCount);
+	static void optimiseVertexCache(unsigned int* indices, int indexCount, int vertexCount);
+
+	static void optimiseOverdraw(unsigned int* indices, int indexCount, const float* positions, int stride, int vertexCount);
+	static void optimiseVertexFetch(unsigned int* indices, int indexCount, int vertexCount, vector<int>* remap);
+};
+
+#endif
@@ -9,6 +9,7 @@
 
 #include "ShaderInterface.h"
 #include "Terrain.h"
+#include "MeshOptimiser.h"
 
 // Model max scaling values
 #define TREE_MAX	0.005f
@@ -29,6 +30,109 @@ private:
 	vector<vec3> grassModPos;
 	vector<vec3> oasisModPos;
 
+	// World the model positions were taken from
+	int worldVersion;
+
+	// World space x/z of every model (grass biome models, then oasis models),
+	// and the ground height under each - sampled every frame, so the models
+	// stay on the ground as it is edited
+	vector<float> modelX;
+	vector<float> modelZ;
+	vector<float> groundHeights;
+
+	// Fetches the model positions of the terrain's current world
+	void getModelPositions()
+	{
+		grassModPos.clear();
+		oasisModPos.clear();
+
+		terrain->getGrassModelPositions(&grassModPos);
+		terrain->getOasisModelPositions(&oasisModPos);
+		worldVersion = terrain->getWorldVersion();
+
+		modelX.clear();
+		modelZ.clear();
+
+		for (int i = 0; i < grassModPos.size(); i++)
+		{
+			modelX.push_back(TERRAIN_START.x + grassModPos[i].x);
+			modelZ.push_back(TERRAIN_START.z + grassModPos[i].z);
+		}
+
+		for (int i = 0; i < oasisModPos.size(); i++)
+		{
+			modelX.push_back(TERRAIN_START.x + oasisModPos[i].x);
+			modelZ.push_back(TERRAIN_START.z + oasisModPos[i].z);
+		}
+
+		groundHeights.resize(modelX.size());
+	}
+
+	// Reorders each mesh of a model for the GPU (see MeshOptimiser) - the
+	// triangles for the vertex cache and overdraw, then the vertices in the
+	// order they are used - and copies them back into its buffers. Prints
+	// the vertex cache use before and after.
+	void optimiseModel(Model* model, string name)
+	{
+		auto start = chrono::steady_clock::now();
+
+		MeshOptimiser::CacheStats before = { 0, 0, 0 };
+		MeshOptimiser::CacheStats after = { 0, 0, 0 };
+
+		for (int m = 0; m < model->meshes.size(); m++)
+		{
+			Mesh& mesh = model->meshes[m];
+
+			int vertexCount = (int)mesh.vertices.size();
+			int indexCount = (int)mesh.indices.size();
+
+			if (indexCount == 0)
+			{
+				continue;
+			}
+
+			before.add(MeshOptimiser::analyseVertexCache(mesh.indices.data(), indexCount, vertexCount));
+
+			MeshOptimiser::optimiseVertexCache(mesh.indices.data(), indexCount, vertexCount);
+			MeshOptimiser::optimiseOverdraw(mesh.indices.data(), indexCount, &mesh.vertices[0].Position.x, sizeof(Vertex), vertexCount);
+
+			vector<int> remap;
+			MeshOptimiser::optimiseVertexFetch(mesh.indices.data(), indexCount, vertexCount, &remap);
+
+			vector<Vertex> vertices(vertexCount);
+
+			for (int v = 0; v < vertexCount; v++)
+			{
+				vertices[remap[v]] = mesh.vertices[v];
+			}
+
+			mesh.vertices.swap(vertices);
+
+			after.add(MeshOptimiser::analyseVertexCache(mesh.indices.data(), indexCount, vertexCount));
+
+			// The mesh's buffers are its own, but are found through its VAO.
+			// Both keep their size, so are overwritten in place.
+			GLint vertexBuffer = 0;
+			GLint indexBuffer = 0;
+
+			glBindVertexArray(mesh.VAO);
+			glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &indexBuffer);
+			glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &vertexBuffer);
+
+			glBindBuffer(GL_ARRAY_BUFFER, (GLuint)vertexBuffer);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, vertexCount * sizeof(Vertex), mesh.vertices.data());
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexCount * sizeof(unsigned int), mesh.indices.data());
+
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glBindVertexArray(0);
+		}
+
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		cout << "Optimised " << name << " model (" << before.triangles << " triangles) in " << ms << " ms - ACMR "
+			<< before.getACMR() << " -> " << after.getACMR() << ", ATVR " << before.getATVR() << " -> " << after.getATVR() << "\n";
+	}
+
 public:
 	ModelSet(Terrain* t, string vertexShader, string fragShader, int* err) : ShaderInterface(vertexShader, fragShader, err)
 	{
@@ -36,36 +140,48 @@ public:
 		tree = new Model("media/palmTree/CordylineFREE.obj");
 		cactus = new Model("media/cactus/scene.gltf");
 
+		// Done once at load, so the draws of every model instance benefit
+		optimiseModel(grass, "grass");
+		optimiseModel(tree, "palm tree");
+		optimiseModel(cactus, "cactus");
+
 		terrain = t;
 
-		terrain->getGrassModelPositions(&grassModPos);
-		terrain->getOasisModelPositions(&oasisModPos);
+		getModelPositions();
 
 		modelPos = vec3(0.0f);
 	}
 
+	// The terrain is not owned by the models, and the shaders are freed by
+	// ShaderInterface
 	~ModelSet()
 	{
-		free(grass);
-		free(tree);
-		free(cactus);
-		free(terrain);
-
-		glUseProgram(0);
-		free(shaders);
+		delete grass;
+		delete tree;
+		delete cactus;
 	}
 
 	// Asserts positions of each model generated during terrain creation
 	// and draws them.
 	void drawModels(MVP* mvp)
 	{
+		// Pick up the models of a regenerated world
+		if (worldVersion != terrain->getWorldVersion())
+		{
+			getModelPositions();
+		}
+
+		terrain->getGroundSamples(modelX.data(), modelZ.data(), (int)modelX.size(), groundHeights.data(), NULL, NULL);
+
+		const int oasisStart = (int)grassModPos.size();
+
 		// Draw grass biome models (grass, cacti)
 		for (int i = 0; i < grassModPos.size(); i++)
 		{
 			mvp->resetModel();
 
 			modelPos.x = TERRAIN_START.x + grassModPos[i].x;
-			modelPos.y = TERRAIN_START.y + grassModPos[i].y;
+			modelPos.y = groundHeights[i];
 			modelPos.z = TERRAIN_START.z + grassModPos[i].z;
 
 			// Set starting model position
@@ -102,7 +218,7 @@ public:
 			mvp->resetModel();
 
 			modelPos.x = TERRAIN_START.x + oasisModPos[i].x;
-			modelPos.y = TERRAIN_START.y + oasisModPos[i].y;
+			modelPos.y = groundHeights[oasisStart + i];
 			modelPos.z = TERRAIN_START.z + oasisModPos[i].z;
 
 			// Set starting model position
@@ -0,0 +1,51 @@
+#ifndef RANDOM_H
+
+#define RANDOM_H
+
+#include <cstdint>
+
+// Stateless random numbers for procedural generation. Every value is a hash
+// of the world seed, the stream it is used for and an index (e.g. a vertex
+// or model number), so any value can be worked out on demand, in any order
+// and on any thread, and the same seed always gives the same world.
+class Random
+{
+public:
+	// What each random value is used for - separates the values so that,
+	// for example, a model's rotation does not match its scale
+	enum Stream { TERRAIN_SEED, PATH_SEED, MODEL_SEED, MODEL_TYPE, MODEL_ROTATION, MODEL_SCALE, EROSION_SEED, EROSION_DROPLET };
+
+	// Random 32 bit value for the given seed, stream and index
+	static uint32_t hash(uint32_t seed, Stream stream, uint32_t index)
+	{
+		uint32_t h = mix(seed);
+
+		h = mix(h ^ (uint32_t)stream);
+		h = mix(h ^ index);
+
+		return (h);
+	}
+
+	// Random integer between min and max (inclusive)
+	static int range(uint32_t seed, Stream stream, uint32_t index, int min, int max)
+	{
+		uint64_t values = (uint64_t)(max - min + 1);
+
+		return (min + (int)((hash(seed, stream, index) * values) >> 32));
+	}
+
+private:
+	// Integer hash with good avalanche - every input bit affects every output bit
+	static uint32_t mix(uint32_t x)
+	{
+		x ^= x >> 16;
+		x *= 0x7feb352dU;
+		x ^= x >> 15;
+		x *= 0x846ca68bU;
+		x ^= x >> 16;
+
+		return (x);
+	}
+};
+
+#endif
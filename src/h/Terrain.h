@@ -7,71 +7,85 @@
 #include "MVP.h"
 
 #include "ShaderInterface.h"
+#include "TerrainConfig.h"
+#include "TerrainGenerator.h"
 
 #include <glad/glad.h>
 //#include <GLFW/glfw3.h>
 
 #include <vector>
 #include <string>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 // irrKlang - audio
 #include <irrKlang/irrKlang.h>
 
 #define TERRAIN_START		vec3(0.0f, -2.0f, -1.5f)
 
-#define RENDER_DIST			512							// Map width/height
-#define MAP_SIZE			(RENDER_DIST * RENDER_DIST) // Total map size
-
-#define VERTICE_OFFSET		0.1f						// Distance between each vertice drawn on the terrain
-
-// Global terrain positions
-#define START_POS			VERTICE_OFFSET
-#define END_POS				(RENDER_DIST * VERTICE_OFFSET)
-#define MIDDLE_POS			(END_POS * 0.5)				// Middle coordinate of the map (x & z axes)
-
-// Terrain texture coordinate positions for each corner of the terrain
-#define BTM_LEFT			0
-#define BTM_RIGHT			(RENDER_DIST - 1)
-#define TOP_LEFT			(MAP_SIZE - RENDER_DIST)
-#define TOP_RIGHT			(MAP_SIZE - 1)
-
-#define ROW_CHUNKS			(RENDER_DIST - 1) // No. chunks across a single dimension
-#define CHUNK_TRIANGLES		2 // Two triangles per square chunk
-#define TOTAL_TRIANGLES		(ROW_CHUNKS * ROW_CHUNKS * CHUNK_TRIANGLES) // Total amount of triangles on the map
-
+#define REGEN_UPLOAD_BYTES_PER_FRAME	(2 * 1024 * 1024)	// Max bytes of a regenerated world's vertices uploaded each frame
+#define GROUND_SAMPLE_BLOCK				256					// Positions moved into terrain space at a time by getGroundSamples
+#define PACKED_HEIGHT_HEADROOM			0.25f				// Extra packed height range left past an edit that outgrows it, as a share of the range
 
 using namespace std;
 using namespace irrklang;
 
-// Class for creating the main terrain object.
-class Terrain : public ShaderInterface
+class ChunkManager;
+class TerrainLOD;
+class TerrainDisplacement;
+class HeightField;
+class TerrainRegions;
+class TerrainCache;
+
+// Class for creating the main terrain object. Generation is done by the
+// TerrainGenerator base class - this adds drawing, editing and audio.
+class Terrain : public ShaderInterface, public TerrainGenerator
 {
 public:
-	enum Biome { GRASS, GRASS_DESERT, DESERT, DESERT_PATH, DESERT_OASIS, OASIS };
+	// Ways the terrain can be edited with a brush
+	enum EditMode { EDIT_RAISE, EDIT_LOWER, EDIT_FLATTEN, EDIT_PAINT };
 
-	Terrain(string vertexShader, string fragShader, int* err) : ShaderInterface(vertexShader, fragShader, err)
+	Terrain(TerrainConfig cfg, string vertexShader, string fragShader, int* err) : ShaderInterface(vertexShader, fragShader, err), TerrainGenerator(cfg)
 	{
-		rowIndex = 0;
-		colVerticesOffset = drawStartPos;
-		rowVerticesOffset = drawStartPos;
-		colIndicesOffset = 0;
-		rowIndicesOffset = 0;
-
-		// Generate random model rotations, scaling factors and randomise between
-		// tree/grass or cactus/grass models on grassy and oasis biomes
-		for (int i = 0; i < MAP_SIZE; i++)
+		chunkManager = NULL;
+		terrainLOD = NULL;
+		terrainDisplacement = NULL;
+		terrainVAO = NULL;
+		heightField = NULL;
+		regions = NULL;
+		mapRebuild = NULL;
+		nextWorld = NULL;
+		sound = NULL;
+
+		worldVersion = 0;
+		biomesEdited = false;
+		lodScreenHeight = 0.0f;
+		packedHeightMin = 0.0f;
+		packedHeightScale = 1.0f;
+
+		terrainMVP = mat4(1.0f);
+		drawnTriangles = 0;
+		culledTriangles = 0;
+
+		if (config.streamChunks)
 		{
-			modelType[i] = rand() % 2;
-			rotation[i] = rand() % (180 - -180 + 1) + -180;
-			scaling[i] = rand() % (2 - 1 + 1) + 1;
+			// Chunks are generated around the camera as it moves - the fixed
+			// map, and its models and regions, are never built
+			enableStreaming();
 		}
+		else
+		{
+			// Generate the terrain, or load it if it was cached by an earlier run
+			buildTerrain();
 
-		generateVertices();
-		generateLandscape();
-		setTextureCoords();
-		generateNormals();
+			// Find the separate oases and grassland patches
+			labelRegions();
+
+			// Only the height and biome maps are kept once the mesh is on the GPU
+			releaseMesh();
+		}
 
-		createTerrainVAO();
 		setTextures();
 
 		// Set up audio
@@ -87,17 +101,29 @@ public:
 
 	~Terrain();
 
-	void getGrassModelPositions(vector<vec3>* positions);
-	void getOasisModelPositions(vector<vec3>* positions);
-	Biome offsetUserPos(vec3* pos);
 	bool isAtEdge(vec3 pos);
-
-	const int getModelType(int idx);
-	const int getRotation(int idx);
-	const int getScale(int idx);
+	void getGroundSamples(const float* x, const float* z, int count, float* heights, vec3* normals, Biome* biomes);
+	float getWaterDistance(vec3 pos);
+	const TerrainRegions* getRegions();
 
 	void drawTerrain();
 
+	void editTerrain(EditMode mode, vec3 pos, float radius, float strength, Biome paintBiome = GRASS);
+
+	void regenerate(unsigned int seed);
+	bool isRegenerating();
+	int getWorldVersion();
+
+	void updateStreaming(vec3 cameraPos);
+
+	void enableLOD(float screenHeight);
+	void setScreenHeight(float screenHeight);
+	int getDrawnTriangles();
+	int getCulledTriangles();
+
+	void setMVP(MVP* mvp) override;
+	void setShaderPositions(vec3 lightPos, vec3 cameraPos) override;
+
 	void updateListenerPosition(vec3 pos, vec3 front);
 
 private:
@@ -111,49 +137,183 @@ private:
 	// Position of the model to assign the bird sound to (3D sound)
 	vec3 soundTreeModel;
 
-	// Stores all vertices - triangles across the whole map, with 11 values for each triangle
-	// - 3 for vertices, 3 for colours, 3 for normals, 2 for textures
-	VAO::VertexData terrainVertices[MAP_SIZE];
-	int				normalsCalc[MAP_SIZE];
-
 	VAO*			terrainVAO;
 
-	// All textures to be used on the terrain
-	vector<TerrainTexture*> textures;
+	// Height range the packed vertices are stored over
+	float			packedHeightMin;
+	float			packedHeightScale;
+
+	// Streams chunks in around the camera when config.streamChunks is set
+	ChunkManager*	chunkManager;
+
+	// Draws the terrain with distance-based detail when LOD is enabled
+	TerrainLOD*		terrainLOD;
+
+	// Draws the terrain from height/biome textures when GPU displacement is enabled
+	TerrainDisplacement*	terrainDisplacement;
+
+	// Heights and biomes laid out for direct lookups by position
+	HeightField*	heightField;
 
-	int modelType[MAP_SIZE];
-	int rotation[MAP_SIZE];
-	int scaling[MAP_SIZE];
+	// Oases and grassland patches, relabelled after edits change the biomes
+	TerrainRegions*	regions;
 
-	// Model positions
-	vector<vec3>	grassModelPositions;
-	vector<vec3>	oasisModelPositions;
+	// Regions and water distances being found again after edits changed the
+	// biomes. Once edits stop, the maps are copied and worked over on the
+	// thread pool, while the terrain carries on being drawn and edited, then
+	// the results are swapped in.
+	struct MapRebuild
+	{
+		vector<unsigned char>	biomeMap;
+		vector<float>			heightMap;
+		TerrainRegions*			regions;
+		vector<unsigned short>	waterDistanceMap;
+
+		// Version of the world the maps were copied from
+		int						worldVersion;
+
+		// Set by the worker once the regions and water distances are ready,
+		// and signalled before the lock is released - the owner deletes the
+		// struct as soon as it sees done, which can be a while after the
+		// worker started on a large map
+		bool					done;
+		mutex					lock;
+		condition_variable		doneSignal;
+	};
+
+	MapRebuild*		mapRebuild;
+
+	// Set when an edit changes a biome, until the maps are copied for a rebuild
+	bool			biomesEdited;
+
+	// A square chunk of the terrain mesh - its own block of the vertex buffer,
+	// drawn with the shared index pattern (or its own range of the adaptive
+	// mesh's indices), with the box around it for frustum culling
+	struct MeshChunk
+	{
+		int		baseVertex;
+		int		firstIndex;
+		int		indexCount;
+		int		triangles;
+		vec3	boxMin;
+		vec3	boxMax;
+	};
+
+	vector<MeshChunk>	meshChunks;
+
+	// A world being built by regenerate() to replace this one. It is
+	// generated on the thread pool while the current world is drawn, along
+	// with everything the swap needs (chunk boxes, LOD/displacement data).
+	// Its vertices and textures are then uploaded a slice per frame. Once a
+	// fence shows the GPU has all of them, the two worlds are swapped.
+	struct NextWorld
+	{
+		TerrainGenerator*				generator;
+		TerrainRegions*					regions;
+		vector<VAO::VertexData>			vertices;
+		vector<VAO::PackedVertexData>	packedVertices;
+		vector<GLushort>				indices;
+		vector<int>						indexStarts;
+		float							packedHeightMin;
+		float							packedHeightScale;
+		vector<MeshChunk>				meshChunks;
+
+		// Made by the worker when this world uses them, uploaded before the fence
+		bool					useLOD;
+		float					screenHeight;
+		TerrainLOD*				lod;
+		TerrainDisplacement*	displacement;
+
+		// Set by the worker once the world is ready to upload
+		bool					generated;
+		mutex					lock;
+		condition_variable		generatedSignal;
+
+		VAO*					vao;
+		int						uploadedBytes;
+		GLsync					fence;
+
+		// For the report printed after the swap
+		chrono::steady_clock::time_point	startTime;
+		double					generateMs;
+		int						uploadFrames;
+		double					longestFrameMs;
+	};
+
+	NextWorld*		nextWorld;
+
+	// Incremented each time regenerate() swaps in a new world
+	int				worldVersion;
+
+	// Framebuffer height the LOD is picked for, to rebuild it for a new world
+	float			lodScreenHeight;
+
+	// Area of the map changed by an edit - rows [firstRow, endRow) and
+	// columns [firstCol, endCol)
+	struct EditRect
+	{
+		int		firstRow;
+		int		endRow;
+		int		firstCol;
+		int		endCol;
+	};
 
-	// Terrain indices
-	ivec3 terrainIndices[TOTAL_TRIANGLES];
+	// Edited areas whose normals and GPU vertices are still to be updated
+	vector<EditRect>	dirtyRects;
 
-	// For drawing
-	const float drawStartPos = START_POS;
-	float colVerticesOffset;
-	float rowVerticesOffset;
+	// Draw parameters of the visible chunks, rebuilt each frame
+	vector<GLsizei>		visibleCounts;
+	vector<const void*>	visibleOffsets;
+	vector<GLint>		visibleBaseVertices;
 
-	int colIndicesOffset;
-	int rowIndicesOffset;
+	int				drawnTriangles;
+	int				culledTriangles;
 
-	// Current chunk in current row being drawn
-	int rowIndex;
+	// Latest camera position and MVP matrix, in terrain space - used to
+	// cull the mesh chunks and pick the LOD nodes
+	vec3			terrainCameraPos;
+	mat4			terrainMVP;
+
+	// All textures to be used on the terrain
+	vector<TerrainTexture*> textures;
 
-	void generateVertices();
-	void generateLandscape();
-	void setTextureCoords();
-	void generateNormals();
-	void createTerrainVAO();
+	// Triangles joining the vertices of one mesh chunk - the same for every
+	// chunk, so the index buffer does not grow with the map. With an
+	// adaptive mesh, each chunk's own triangles instead, one after another,
+	// with chunk i's from chunkIndexStarts[i] to chunkIndexStarts[i + 1].
+	vector<GLushort> chunkIndices;
+	vector<int>		chunkIndexStarts;
+
+	void buildTerrain();
+	void loadTerrain(TerrainCache* cache);
+	void generateIndices();
+	void createMeshChunks(const TerrainGenerator& world, const vector<int>& indexStarts, vector<MeshChunk>* chunks);
+	void updateMeshChunkBox(const TerrainGenerator& world, int chunk, MeshChunk* meshChunk);
+	void applyEdits();
+	void enableStreaming();
+	void updateMapRebuild();
+	void uploadVertices(const EditRect& rect);
+	void widenPackedRange(const EditRect& rect);
+	void rebuildAdaptiveChunks();
+	void setAdaptiveRange(MeshChunk* chunk, const vector<int>& indexStarts, int index);
+	bool isAdaptive();
+	void drawMeshChunks();
+	void createHeightField();
+	void labelRegions();
+	void releaseMesh();
+	void createTerrainVAO(const VAO::VertexData* vertexData);
+	void createPackedTerrainVAO(const VAO::VertexData* vertexData);
+	VAO* createMeshVAO(const void* vertexData, int size, const vector<GLushort>& indices);
+	const vector<float>& getFloatHeights(vector<float>* unpacked);
+	void generateNextWorld(NextWorld* next);
+	void updateRegeneration();
+	void swapWorlds();
 	void setTextures();
 
 	void setSoundTree();
 
-	Biome getBiome(float terrain, float path);
-	bool getIfModelPlacement(Biome biome, float noise);
+	static void packVertices(const VAO::VertexData* vertexData, int count, vector<VAO::PackedVertexData>* packedVertices, float* heightMin, float* heightScale);
+	static void packVertices(const VAO::VertexData* vertexData, int count, vector<VAO::PackedVertexData>* packedVertices, float heightMin, float heightScale);
 };
 
 #endif
\ No newline at end of file
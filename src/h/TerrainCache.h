@@ -0,0 +1,88 @@
+#ifndef TERRAINCACHE_H
+
+#define TERRAINCACHE_H
+
+#include "Buffers.h" // Includes GLM
+#include "TerrainConfig.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#define TERRAIN_CACHE_FOLDER	"cache/"
+#define TERRAIN_CACHE_MAGIC		"TCCH"
+#define TERRAIN_CACHE_VERSION	6
+#define TERRAIN_CACHE_ALIGN		16		// Alignment of each data block in the file, in bytes
+
+using namespace std;
+
+// Saves a generated terrain to disk, and memory-maps it back in on later runs
+// with the same settings so generation can be skipped. One file is kept per
+// set of generation settings - the file layout is described in the README.
+class TerrainCache
+{
+public:
+	// Start of every cache file. All values are little-endian and every
+	// offset is in bytes from the start of the file.
+	struct Header
+	{
+		char		magic[4];			// TERRAIN_CACHE_MAGIC
+		uint32_t	version;			// TERRAIN_CACHE_VERSION
+		uint32_t	headerSize;			// sizeof(Header)
+		uint32_t	vertexStride;		// sizeof(VAO::VertexData)
+
+		// Settings the terrain was generated with
+		int32_t		gridSize;
+		float		verticeOffset;
+		float		terrainFrequency;
+		float		pathFrequency;
+		float		modelFrequency;
+		uint32_t	worldSeed;
+		int32_t		erosionIterations;
+		uint32_t	erosionSeed;
+
+		uint64_t	vertexOffset;		// Terrain vertices, chunk by chunk as drawn
+		uint64_t	vertexCount;
+		uint64_t	grassOffset;		// Grass model positions (3 x float each)
+		uint64_t	grassCount;
+		uint64_t	oasisOffset;		// Oasis model positions (3 x float each)
+		uint64_t	oasisCount;
+		uint64_t	heightMapOffset;	// Height of every vertex (float), row by row
+		uint64_t	biomeMapOffset;		// Biome of every vertex (1 byte), row by row
+
+		uint64_t	fileSize;			// Total file size - catches partly written files
+	};
+
+	TerrainCache(const TerrainConfig& cfg);
+	~TerrainCache();
+
+	bool load();
+	bool save(const vector<VAO::VertexData>& vertices,
+		const vector<vec3>& grassPositions, const vector<vec3>& oasisPositions,
+		const vector<float>& heightMap, const vector<unsigned char>& biomeMap);
+
+	const string& getFileName();
+
+	const VAO::VertexData* getVertices();
+	const vec3* getGrassPositions();
+	const vec3* getOasisPositions();
+	const float* getHeightMap();
+	const unsigned char* getBiomeMap();
+
+	const Header* getHeader();
+
+private:
+	TerrainConfig	config;
+	string			fileName;
+
+	// Read-only view of the whole file while it is loaded
+	const char*		mappedData;
+	size_t			mappedSize;
+
+	Header makeHeader();
+	bool isValid();
+
+	void unmap();
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef TERRAINCONFIG_H
+
+#define TERRAINCONFIG_H
+
+#include "Random.h"
+
+#define DEFAULT_GRID_SIZE		512		// Default map width/height (in vertices)
+#define DEFAULT_VERTICE_OFFSET	0.1f	// Default distance between each vertice drawn on the terrain
+
+#define CHUNK_TRIANGLES			2		// Two triangles per square chunk
+#define DRAW_CHUNK_QUADS		32		// Quads along each side of a chunk of the terrain mesh, for culling
+
+// Settings used to generate a terrain - map size, vertex spacing and the noise
+// frequencies/seeds. Passed to the Terrain at runtime so the same program can
+// generate maps of any size.
+struct TerrainConfig
+{
+	int		gridSize;			// Map width/height in vertices
+	float	verticeOffset;		// Distance between each vertice
+
+	float	terrainFrequency;	// Height map noise scale
+	float	pathFrequency;		// Pathway noise scale
+	float	modelFrequency;		// Model placement noise scale
+
+	unsigned int	worldSeed;	// Every random value in the world is derived from this
+
+	int		erosionIterations;	// Erosion passes run over the generated heights (0 for none)
+	unsigned int	erosionSeed;	// Picks between different erosion runs of the same world
+
+	bool	useCache;			// Load/save the generated terrain from/to disk
+	bool	streamChunks;		// Stream chunks in around the camera instead of building the fixed map
+	bool	displaceOnGPU;		// Draw from height/biome textures instead of building a mesh
+	bool	packVertices;		// Upload the terrain mesh in the compact 12 byte vertex layout
+	bool	keepMesh;			// Keep the CPU copy of the vertices once they are on the GPU
+	bool	halfHeights;		// Keep the height map as 16 bit floats once the vertices are released
+	float	meshError;			// Max height error of the adaptive (RTIN) mesh, 0 for the full grid
+
+	TerrainConfig()
+	{
+		gridSize			= DEFAULT_GRID_SIZE;
+		verticeOffset		= DEFAULT_VERTICE_OFFSET;
+
+		terrainFrequency	= 0.025f;
+		pathFrequency		= 0.05f;
+		modelFrequency		= 10.0f;
+
+		worldSeed			= 0;
+
+		erosionIterations	= 0;
+		erosionSeed			= 0;
+
+		useCache			= false;
+		streamChunks		= false;
+		displaceOnGPU		= false;
+		packVertices		= false;
+		keepMesh			= false;
+		halfHeights			= false;
+		meshError			= 0.0f;
+	}
+
+	// Seeds for the height, pathway and model placement noise
+	int getTerrainSeed() const
+	{
+		return ((int)Random::hash(worldSeed, Random::TERRAIN_SEED, 0));
+	}
+
+	int getPathSeed() const
+	{
+		return ((int)Random::hash(worldSeed, Random::PATH_SEED, 0));
+	}
+
+	int getModelSeed() const
+	{
+		return ((int)Random::hash(worldSeed, Random::MODEL_SEED, 0));
+	}
+
+	// Seed for the erosion droplets
+	unsigned int getErosionSeed() const
+	{
+		return (Random::hash(worldSeed, Random::EROSION_SEED, erosionSeed));
+	}
+
+	// Total number of vertices on the map
+	int getMapSize() const
+	{
+		return (gridSize * gridSize);
+	}
+
+	// No. chunks (squares) across a single dimension
+	int getRowChunks() const
+	{
+		return (gridSize - 1);
+	}
+
+	// Total amount of triangles on the map
+	int getTotalTriangles() const
+	{
+		return (getRowChunks() * getRowChunks() * CHUNK_TRIANGLES);
+	}
+
+	// No. mesh chunks across a single dimension - the last may be partly
+	// off the map
+	int getDrawChunks() const
+	{
+		return ((getRowChunks() + DRAW_CHUNK_QUADS - 1) / DRAW_CHUNK_QUADS);
+	}
+
+	// Vertices stored for each mesh chunk - edges are shared with the
+	// neighbouring chunks, so they are stored in both
+	int getDrawChunkVertices() const
+	{
+		return ((DRAW_CHUNK_QUADS + 1) * (DRAW_CHUNK_QUADS + 1));
+	}
+
+	// Total vertices in the chunk by chunk terrain mesh
+	int getDrawVertexCount() const
+	{
+		return (getDrawChunks() * getDrawChunks() * getDrawChunkVertices());
+	}
+
+	// Indices in the triangle list pattern shared by every mesh chunk
+	int getDrawChunkIndices() const
+	{
+		return (DRAW_CHUNK_QUADS * DRAW_CHUNK_QUADS * CHUNK_TRIANGLES * 3);
+	}
+
+	// Global terrain positions (x & z axes)
+	float getStartPos() const
+	{
+		return (verticeOffset);
+	}
+
+	float getEndPos() const
+	{
+		return (gridSize * verticeOffset);
+	}
+
+	// Middle coordinate of the map
+	float getMiddlePos() const
+	{
+		return (getEndPos() * 0.5f);
+	}
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef TERRAINDISPLACEMENT_H
+
+#define TERRAINDISPLACEMENT_H
+
+#include "Buffers.h" // Includes GLM
+#include "TerrainConfig.h"
+#include "TerrainGenerator.h"
+
+// Shaders
+#include <learnopengl/shader_m.h>
+
+#include <vector>
+
+#define DISPLACE_PATCH_SIZE		64	// Quads along each side of the patch mesh
+
+using namespace std;
+using namespace glm;
+
+// Draws the full detail terrain without a terrain mesh. Only a 16 bit height
+// texture and a biome colour texture are uploaded, and one small flat patch
+// is drawn once per square of the map (instanced), displaced by the heights in
+// terrainShader.vert. Positions, texture coordinates and normals all come from
+// the grid position in the shader.
+//
+// As with TerrainLOD, the constructor only works on the CPU, and
+// uploadTextures must finish on the render thread before it is drawn.
+class TerrainDisplacement
+{
+public:
+	TerrainDisplacement(const TerrainConfig& cfg, const vector<float>& heightMap, const vector<unsigned char>& biomeMap, Shader* terrainShader);
+	~TerrainDisplacement();
+
+	int uploadTextures(int maxBytes);
+	bool isUploaded();
+
+	void drawTerrain();
+
+	int getDrawnTriangles();
+	size_t getGPUMemory();
+
+private:
+	TerrainConfig	config;
+	Shader*			shaders;
+
+	VAO*			patchVAO;
+	int				patchIndexCount;
+	int				patchesPerSide;
+
+	GLuint			heightTexture;
+	GLuint			biomeTexture;
+
+	// Texture data waiting to be uploaded, and how many rows of each are done
+	vector<unsigned short>	heightPixels;
+	vector<unsigned char>	biomePixels;
+	int						heightRows;
+	int						biomeRows;
+
+	// Maps the 16 bit texture values (0-1) back to heights
+	float			heightMin;
+	float			heightScale;
+
+	void createTextureData(const vector<float>& heightMap, const vector<unsigned char>& biomeMap);
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef TERRAINDISTANCE_H
+
+#define TERRAINDISTANCE_H
+
+#include "TerrainConfig.h"
+
+#include <vector>
+
+#define DISTANCE_BLOCK_COLUMNS	64	// Columns swept by one thread at a time in the column pass
+
+using namespace std;
+
+// Works out how far every vertex is from the nearest vertex of one biome
+// (e.g. oasis water) - an exact Euclidean distance transform of the biome
+// map. Done in two passes that each look along one axis:
+//  1. Down each column, the distance in rows to the nearest source vertex in
+//     that column - blocks of columns are swept in parallel.
+//  2. Along each row, the nearest of those per column distances, combined
+//     as sqrt(columns^2 + rows^2) with the lower envelope of parabolas
+//     (Felzenszwalb and Huttenlocher) - rows are done in parallel.
+// Both passes are linear in the number of vertices, and the result is the
+// same on any number of threads.
+class TerrainDistance
+{
+public:
+	TerrainDistance(const TerrainConfig& cfg);
+
+	void build(const vector<unsigned char>& biomeMap, unsigned char sourceBiome, vector<unsigned short>* distances);
+
+	double getBuildMs();
+
+private:
+	TerrainConfig	config;
+
+	double			buildMs;
+
+	void columnPass(const unsigned char* biomes, unsigned char sourceBiome, int* columnDistances, int firstCol, int endCol);
+	void rowPass(const int* columnDistances, unsigned short* distances, int firstRow, int endRow);
+};
+
+#endif
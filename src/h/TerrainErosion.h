@@ -0,0 +1,59 @@
+#ifndef TERRAINEROSION_H
+
+#define TERRAINEROSION_H
+
+#include "TerrainConfig.h"
+
+#include <vector>
+
+#define ERODE_TILE_SIZE			64		// Cells along each side of a droplet tile
+#define ERODE_CELLS_PER_DROPLET	16		// One droplet per this many cells, per iteration
+#define ERODE_MAX_LIFETIME		30		// Steps before a droplet evaporates
+#define ERODE_RADIUS			2		// Droplets wear away the vertices within this many vertices of them
+
+#define ERODE_INERTIA			0.05f	// How much a droplet keeps its direction instead of running downhill
+#define ERODE_CAPACITY			4.0f	// Sediment a droplet can carry, per unit of speed/water/slope
+#define ERODE_MIN_CAPACITY		0.001f	// Lets droplets on flat ground still carry a little sediment
+#define ERODE_ERODE_SPEED		0.3f	// Fraction of the spare capacity picked up each step
+#define ERODE_DEPOSIT_SPEED		0.3f	// Fraction of the excess sediment dropped each step
+#define ERODE_EVAPORATE_SPEED	0.01f	// Fraction of water lost each step
+#define ERODE_GRAVITY			4.0f
+
+#define ERODE_TALUS_ANGLE		34.0f	// Steepest stable slope (degrees) - about the angle of repose of dry sand
+#define ERODE_THERMAL_RATE		0.1f	// Fraction of the excess slope moved per pass (at most 0.125 to stay stable)
+
+using namespace std;
+
+// Erodes a height map, run on the terrain heights between generating the
+// landscape and the normals. Each iteration is a hydraulic pass - water
+// droplets that wear sediment away from slopes and drop it further down -
+// then a thermal pass, where anything steeper than the talus angle slides
+// down to its neighbours.
+//
+// Droplets run in square tiles, each kept inside its tile. Tiles are done in
+// four phases, so tiles running at the same time never touch, and the droplets
+// in a tile always run in the same order - the result does not depend on the
+// number of threads. The tile grid moves each iteration so there are no seams.
+class TerrainErosion
+{
+public:
+	TerrainErosion(const TerrainConfig& cfg);
+
+	void erode(vector<float>* heights);
+
+private:
+	TerrainConfig	config;
+	unsigned int	seed;
+
+	// Largest stable height difference between neighbouring vertices
+	float			talus;
+
+	void hydraulicPass(float* heights, int iteration);
+	void erodeTile(float* heights, int iteration, int tile, int minX, int minY, int maxX, int maxY);
+	void thermalPass(const float* src, float* dst);
+	void thermalRows(const float* src, float* dst, int firstRow, int endRow);
+
+	float getThermalCell(const float* src, int x, int y);
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef TERRAINGENERATOR_H
+
+#define TERRAINGENERATOR_H
+
+#include "VertexData.h" // Includes GLM
+#include "TerrainConfig.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <vector>
+#include <string>
+
+// Target size of each block of rows handed to a worker thread during
+// generation - roughly a core's L2 cache
+#define GEN_BLOCK_BYTES		(256 * 1024)
+
+using namespace std;
+using namespace glm;
+
+class TerrainNoise;
+
+// Generates a terrain on the CPU - vertex positions, heights, biome colours,
+// model positions, texture coordinates and normals. Uses no OpenGL, so a
+// world can be generated without a window (see tools/TerrainGen). The
+// Terrain class builds on this to draw it.
+class TerrainGenerator
+{
+public:
+	enum Biome { GRASS, GRASS_DESERT, DESERT, DESERT_PATH, DESERT_OASIS, OASIS, BIOME_COUNT };
+	enum ModelSet { MODELS_NONE, MODELS_GRASS, MODELS_OASIS };
+	enum RegionType { REGION_NONE, REGION_GRASS, REGION_OASIS, REGION_TYPE_COUNT };
+
+	// How each biome looks and what is placed on it. Indexed by Biome - a new
+	// biome needs an entry here and a band in the classification table.
+	struct BiomeInfo
+	{
+		float		weights[4];	// Terrain shader texture weights - sand, grass, water, sand path
+		Biome		walkBiome;	// GRASS, DESERT or OASIS - picks the footstep sound
+		ModelSet	models;		// Models placed in this biome
+		float		modelBound;	// Model noise must exceed this for a model to be placed
+		RegionType	region;		// Kind of region (see TerrainRegions) this biome is part of
+	};
+
+	static const BiomeInfo biomeTable[BIOME_COUNT];
+
+	// Wall time taken by one stage of generation
+	struct StageTime
+	{
+		string	name;
+		double	ms;
+	};
+
+	TerrainGenerator(const TerrainConfig& cfg);
+
+	void generate(bool heightsOnly = false);
+	void createChunkVertices(vector<VertexData>* chunkVertices);
+	void releaseVertices(bool halfHeights);
+
+	const TerrainConfig& getConfig();
+	const vector<VertexData>& getVertices();
+	const vector<float>& getHeightMap() const;
+	const vector<unsigned char>& getBiomeMap() const;
+	const vector<StageTime>& getStageTimes();
+
+	// Height and biome of a vertex, however the height map is stored
+	float getMapHeight(int i) const
+	{
+		return (halfHeightMap.empty() ? heightMap[i] : unpackHalf1x16(halfHeightMap[i]));
+	}
+
+	Biome getMapBiome(int i) const
+	{
+		return ((Biome)biomeMap[i]);
+	}
+
+	// Distance from a vertex to the nearest oasis water, in terrain units
+	float getWaterDistance(int i) const
+	{
+		return (unpackHalf1x16(waterDistanceMap[i]));
+	}
+
+	// Whether the vertices are still held on the CPU
+	bool isMeshResident() const
+	{
+		return (!terrainVertices.empty());
+	}
+
+	// Whether the heights are stored as half floats
+	bool hasHalfHeights() const
+	{
+		return (!halfHeightMap.empty());
+	}
+
+	size_t getMapBytes() const;
+
+	void getGrassModelPositions(vector<vec3>* positions);
+	void getOasisModelPositions(vector<vec3>* positions);
+
+	const int getModelType(int idx);
+	const int getRotation(int idx);
+	const int getScale(int idx);
+
+	static Biome getBiome(float terrain, float path);
+	static void getBiomes(const float* terrain, const float* path, int count, unsigned char* biomes);
+	static vec4 getBiomeColour(Biome biome);
+
+protected:
+	// Map size, spacing and noise settings this terrain was generated with
+	TerrainConfig	config;
+
+	// Stores all vertices - triangles across the whole map, with 12 values for each vertex
+	// - 3 for vertices, 4 for colours, 3 for normals, 2 for textures
+	vector<VertexData>	terrainVertices;
+
+	// Height and biome of every vertex, row by row. CPU queries (walking,
+	// culling, placement) read these instead of the 48 byte vertices.
+	vector<float>			heightMap;
+	vector<unsigned char>	biomeMap;
+
+	// Heights as 16 bit floats - replaces the height map when the vertices
+	// are released with halfHeights set
+	vector<unsigned short>	halfHeightMap;
+
+	// Distance from each vertex to the nearest oasis water (16 bit floats),
+	// row by row - infinite if the map has no water
+	vector<unsigned short>	waterDistanceMap;
+
+	// x of each column and z of each row, made with the vertices (or saved
+	// when loaded vertices are released) so they can be rebuilt with the
+	// same positions
+	vector<float>	columnPositions;
+	vector<float>	rowPositions;
+
+	// Model positions
+	vector<vec3>	grassModelPositions;
+	vector<vec3>	oasisModelPositions;
+
+	// Time taken by each stage of the last generate()
+	vector<StageTime>	stageTimes;
+
+	void runStage(const string& name, void (TerrainGenerator::*stage)());
+
+	void generateVertices();
+	void generateLandscape();
+	void generateLandscapeRows(int firstRow, int endRow, const TerrainNoise& noise, vector<vec3>* grassPositions, vector<vec3>* oasisPositions);
+	void erodeTerrain();
+	void createWaterDistanceMap();
+	void setTextureCoords();
+	void generateNormals();
+	void generateNormals(int firstRow, int endRow, int firstCol, int endCol);
+	void generateNormalRows(int firstRow, int endRow, int firstCol, int endCol);
+
+	void setMapHeight(int i, float height);
+	VertexData getChunkVertex(int chunk, int row, int col);
+	VertexData getVertex(int row, int col) const;
+	vec3 getNormal(int row, int col) const;
+
+	static bool getIfModelPlacement(Biome biome, float noise);
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef TERRAINLOD_H
+
+#define TERRAINLOD_H
+
+#include "Buffers.h" // Includes GLM
+#include "Frustum.h"
+#include "TerrainConfig.h"
+#include "TerrainGenerator.h"
+
+// Shaders
+#include <learnopengl/shader_m.h>
+
+#include <vector>
+
+#define LOD_PATCH_SIZE			32		// Quads along each side of the patch mesh drawn for every node
+#define LOD_MAX_PIXEL_ERROR		4.0f	// Max height error allowed on screen, in pixels
+#define LOD_MORPH_START			0.7f	// Fraction of a level's range after which vertices start morphing
+#define LOD_FIELD_OF_VIEW		45.0f	// Vertical field of view - matches MVP::setProjection
+#define MAP_HEIGHT_TEXTURE_SLOT	4		// Texture units used for the height/biome maps, also by TerrainDisplacement (0-3 are the terrain textures)
+#define MAP_BIOME_TEXTURE_SLOT	5
+
+using namespace std;
+using namespace glm;
+
+// Draws the terrain with continuous distance-dependent level of detail (CDLOD).
+// The heights and biome colours are uploaded as textures, and a quadtree over
+// the map picks a detail level for each area based on how large its height
+// error would be on screen. Every selected node draws the same small patch
+// mesh, displaced in terrainShader.vert, with vertices morphed towards the
+// next level down so there is no popping between levels.
+//
+// The constructor only works on the CPU, so can run on a worker thread. The
+// textures are uploaded by uploadTextures on the render thread, which must
+// have finished before the terrain is drawn.
+class TerrainLOD
+{
+public:
+	TerrainLOD(const TerrainConfig& cfg, const vector<float>& heightMap, const vector<unsigned char>& biomeMap, float screenHeight, Shader* terrainShader);
+	~TerrainLOD();
+
+	int uploadTextures(int maxBytes);
+	bool isUploaded();
+
+	void drawTerrain(vec3 cameraPos, mat4 mvpMatrix);
+	void setScreenHeight(float screenHeight);
+
+	int getDrawnTriangles();
+
+	static VAO* createPatch(int patchSize, int* indexCount);
+	static void getBiomeColours(const vector<unsigned char>& biomeMap, vector<unsigned char>* colours);
+	static GLuint createMapTexture(int gridSize, GLint internalFormat, GLenum format, GLenum type, const void* pixels);
+	static int uploadMapRows(GLuint texture, int gridSize, GLenum format, GLenum type, int rowBytes, const void* pixels, int* uploadedRows, int maxBytes);
+	static void setMapUniforms(Shader* terrainShader, const TerrainConfig& cfg);
+
+private:
+	// A quadtree node selected to be drawn this frame
+	struct Node
+	{
+		int col;	// First grid column/row covered by the node
+		int row;
+		int level;	// 0 = full detail, each level above halves the detail
+	};
+
+	TerrainConfig	config;
+	Shader*			shaders;
+
+	VAO*			patchVAO;
+	int				patchIndexCount;
+
+	GLuint			heightTexture;
+	GLuint			biomeTexture;
+
+	// Texture data waiting to be uploaded, and how many rows of each are done
+	vector<float>			heightPixels;
+	vector<unsigned char>	biomePixels;
+	int						heightRows;
+	int						biomeRows;
+
+	int				numLevels;
+	int				rootSize;	// Quads along each side of the root node
+
+	// Min/max height of every node at each level - [level][nodeRow * nodesPerSide + nodeCol]
+	vector<vector<vec2>>	nodeHeights;
+
+	// Largest height error of each level against the full detail heights
+	vector<float>			levelErrors;
+
+	// Distance up to which each level is detailed enough
+	vector<float>			levelRanges;
+
+	vector<Node>			selectedNodes;
+	int						drawnTriangles;
+
+	void calcNodeHeights(const vector<float>& heightMap);
+	void calcLevelRanges(const vector<float>& heightMap, float screenHeight);
+
+	bool selectNode(int col, int row, int level, vec3 cameraPos, Frustum& frustum);
+	void getNodeBounds(int col, int row, int level, vec3* boxMin, vec3* boxMax);
+	bool isInRange(vec3 cameraPos, vec3 boxMin, vec3 boxMax, float range);
+};
+
+#endif
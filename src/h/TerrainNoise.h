@@ -0,0 +1,46 @@
+#ifndef TERRAINNOISE_H
+
+#define TERRAINNOISE_H
+
+// Noise - height maps, model placement
+#include "FastNoiseLite.h"
+
+#include "TerrainConfig.h"
+
+// Holds the noise generators for a terrain and samples them at any
+// grid position. Used by the Terrain and by streamed chunks so that
+// every part of the world is generated from the same functions.
+// Sampling is read-only, so one object can be shared between threads.
+//
+// The three height octaves and the path noise are all Perlin noise, so
+// getSample() works out all four together (four SSE lanes) instead of
+// calling FastNoiseLite four times - giving exactly the same values as
+// FastNoiseLite's Perlin noise. Model noise still uses FastNoiseLite.
+class TerrainNoise
+{
+public:
+	// All noise values for one grid position
+	struct Sample
+	{
+		float height;	// Vertex height (y)
+		float terrain;	// Summed height noise - used to pick the biome
+		float path;		// Pathway (turbulence) noise
+		float model;	// Model placement noise
+	};
+
+	TerrainNoise(const TerrainConfig& cfg);
+
+	Sample getSample(float x, float y) const;
+
+private:
+	float	terrainFrequency;
+	float	pathFrequency;
+	int		terrainSeed;
+	int		pathSeed;
+
+	FastNoiseLite modelNoise;
+
+	static float getPerlin(int seed, float x, float y);
+};
+
+#endif
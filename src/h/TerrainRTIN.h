@@ -0,0 +1,55 @@
+#ifndef TERRAINRTIN_H
+
+#define TERRAINRTIN_H
+
+#include "TerrainGenerator.h"
+
+#include <vector>
+
+#define RTIN_TILE_SIZE		DRAW_CHUNK_QUADS					// Quads along each side of a tile - must be a power of two
+#define RTIN_TILE_SIDE		(RTIN_TILE_SIZE + 1)				// Vertices along each side of a tile
+#define RTIN_TRIANGLES		(RTIN_TILE_SIZE * RTIN_TILE_SIZE * 2 - 2)	// Triangles in the hierarchy, below the two halves of the tile
+
+using namespace std;
+
+// Builds an adaptive mesh for each chunk of the terrain - a right-triangulated
+// irregular network (RTIN), as in Mapbox's Martini. Each chunk starts as two
+// right triangles, and any triangle whose long edge midpoint is further than
+// the max error from the heights below it is split in two at that midpoint.
+// Flat ground is covered by a few large triangles, and steep ground by many
+// small ones, with no gaps (splits on shared edges always match).
+//
+// The error at each midpoint is worked out once per chunk, smallest
+// triangles first, and includes the errors of the triangles below it - so
+// building a chunk's mesh is linear in its vertices. Triangles index the
+// chunk's own 33x33 vertices (as laid out by createChunkVertices), so the
+// vertex buffer is the same as for the full grid. The edges of each chunk are
+// kept at full detail, so neighbouring chunks always meet without cracks.
+// Each chunk's triangles are reordered for the vertex cache (see
+// MeshOptimiser) unless optimiseCache is turned off.
+class TerrainRTIN
+{
+public:
+	TerrainRTIN(const TerrainConfig& cfg, float maxError, bool optimiseCache = true);
+
+	void buildMesh(const TerrainGenerator* terrain, vector<unsigned short>* indices, vector<int>* chunkStarts);
+	void buildChunk(const TerrainGenerator* terrain, int chunk, vector<unsigned short>* indices);
+
+	double getBuildMs();
+
+private:
+	TerrainConfig	config;
+	float			maxError;
+	bool			optimiseCache;
+
+	double			buildMs;
+
+	// First two corners (the ends of the long edge) of every triangle in the
+	// hierarchy, as x/y within the tile - the third is worked out from them
+	unsigned char	triangleCorners[RTIN_TRIANGLES * 4];
+
+	void getErrors(const float* heights, int validCols, int validRows, float* errors);
+	void addTriangle(const float* errors, int validCols, int validRows, int ax, int ay, int bx, int by, int cx, int cy, vector<unsigned short>* indices);
+};
+
+#endif
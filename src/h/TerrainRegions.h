@@ -0,0 +1,60 @@
+#ifndef TERRAINREGIONS_H
+
+#define TERRAINREGIONS_H
+
+#include "TerrainGenerator.h"
+
+#include <vector>
+
+using namespace std;
+using namespace glm;
+
+// Splits the biome map into regions - each separate patch of grassland, and
+// each oasis (its water and the sand and trees around it). Vertices are in
+// the same region when they are next to each other along a row or column
+// and have the same region type (see TerrainGenerator::biomeTable). Regions
+// give a place to make audio, culling and LOD decisions once per patch,
+// instead of once per vertex.
+//
+// Labelled with union-find. Blocks of rows are labelled on their own by the
+// thread pool, then joined along the rows between blocks. Each region's ID
+// is given by its first vertex, row by row, so the IDs (and everything else)
+// are the same whatever the number of threads. Only reads the maps it is
+// given, so it can work from a copy of them on another thread.
+class TerrainRegions
+{
+public:
+	struct Region
+	{
+		TerrainGenerator::RegionType	type;
+		int								area;		// Vertices in the region
+		vec2							centroid;	// Mean x/z of its vertices, in terrain space
+		vec3							minBounds;	// Terrain space box around it, heights included
+		vec3							maxBounds;
+	};
+
+	TerrainRegions(const TerrainConfig& cfg, const vector<unsigned char>& biomeMap, const vector<float>& heightMap);
+
+	const vector<Region>& getRegions() const;
+	int getRegion(int vertex) const;
+	int getLargestRegion(TerrainGenerator::RegionType type) const;
+	int getRegionCount(TerrainGenerator::RegionType type) const;
+	double getLabelMs() const;
+
+private:
+	int		gridSize;
+	float	verticeOffset;
+	float	startPos;		// x and z of the first vertex
+
+	// Region ID of each vertex, row by row - -1 outside any region. Holds
+	// the union-find parents while labelling.
+	vector<int>		labels;
+	vector<Region>	regions;
+
+	double	labelMs;
+
+	void label(const unsigned char* biomes);
+	void measure(const float* heights);
+};
+
+#endif
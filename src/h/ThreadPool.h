@@ -0,0 +1,40 @@
+#ifndef THREADPOOL_H
+
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// Fixed-size pool of worker threads used to spread CPU-heavy work
+// (e.g. terrain generation) across all available cores.
+class ThreadPool
+{
+public:
+	ThreadPool(int numThreads = 0);
+	~ThreadPool();
+
+	static ThreadPool* getShared();
+
+	int getThreadCount();
+
+	void submit(function<void()> task);
+	void parallelFor(int numBlocks, function<void(int block)> fn);
+
+private:
+	vector<thread>			workers;
+	deque<function<void()>>	tasks;
+
+	mutex					queueLock;
+	condition_variable		queueSignal;
+	bool					stopping;
+
+	void workerLoop();
+};
+
+#endif
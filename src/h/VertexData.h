@@ -0,0 +1,20 @@
+#ifndef VERTEXDATA_H
+
+#define VERTEXDATA_H
+
+// GLM
+#include <glm/glm.hpp>
+
+using namespace glm;
+
+// Structure that stores all data for a given vertex. Kept apart from the
+// buffer classes so it can be used without OpenGL (e.g. by the generator).
+struct VertexData
+{
+	vec3 vertices;
+	vec4 colours;
+	vec3 normals;
+	vec2 textures;
+};
+
+#endif
@@ -0,0 +1,766 @@
+// Headless terrain generator - runs the same generation pipeline as the
+// Desert scene without a window, OpenGL or audio, and prints how long each
+// stage takes. Used as a repeatable CPU benchmark, and can save the height
+// and biome maps as images.
+//
+// Usage: TerrainGen [--size <n>] [--seed <n>] [--erosion <n>] [--erosion-seed <n>]
+//                   [--runs <n>] [--heightmap <file.pgm>] [--biomes <file.ppm>] [--compare-noise]
+//                   [--queries <n>] [--regions] [--check-water <n>] [--adaptive <error>]
+
+#include "..\..\src\h\TerrainGenerator.h"
+#include "..\..\src\h\ThreadPool.h"
+#include "..\..\src\h\TerrainNoise.h"
+#include "..\..\src\h\HeightField.h"
+#include "..\..\src\h\TerrainRegions.h"
+#include "..\..\src\h\TerrainDistance.h"
+#include "..\..\src\h\TerrainRTIN.h"
+#include "..\..\src\h\MeshOptimiser.h"
+#include "..\..\src\h\Random.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <limits>
+#include <math.h>
+
+using namespace std;
+
+// Display colour of each biome texture - sand, grass, water, sand path - in
+// the same order as the vertex colour channels
+const vec3 biomeTextureColours[4] =
+{
+	vec3(230.0f, 200.0f, 140.0f),
+	vec3(90.0f, 150.0f, 60.0f),
+	vec3(60.0f, 110.0f, 200.0f),
+	vec3(180.0f, 150.0f, 100.0f)
+};
+
+// Saves the heights as a 16 bit greyscale PGM, scaled over the height range
+// of the map. Row 0 (the front of the map) is the top of the image.
+bool saveHeightMap(const string& fileName, const TerrainConfig& config, const vector<VertexData>& vertices)
+{
+	float minHeight = vertices[0].vertices.y;
+	float maxHeight = vertices[0].vertices.y;
+
+	for (int i = 1; i < config.getMapSize(); i++)
+	{
+		minHeight = std::min(minHeight, vertices[i].vertices.y);
+		maxHeight = std::max(maxHeight, vertices[i].vertices.y);
+	}
+
+	float scale = maxHeight > minHeight ? 65535.0f / (maxHeight - minHeight) : 0.0f;
+
+	ofstream file(fileName, ios::binary);
+
+	if (!file)
+	{
+		return (false);
+	}
+
+	file << "P5\n" << config.gridSize << " " << config.gridSize << "\n65535\n";
+
+	vector<unsigned char> row(config.gridSize * 2);
+
+	for (int r = 0; r < config.gridSize; r++)
+	{
+		for (int c = 0; c < config.gridSize; c++)
+		{
+			unsigned short value = (unsigned short)((vertices[r * config.gridSize + c].vertices.y - minHeight) * scale + 0.5f);
+
+			// PGM samples are big-endian
+			row[c * 2] = (unsigned char)(value >> 8);
+			row[c * 2 + 1] = (unsigned char)(value & 0xFF);
+		}
+
+		file.write((const char*)row.data(), row.size());
+	}
+
+	return ((bool)file);
+}
+
+// Saves the biome colour map as an 8 bit RGB PPM, blending the colour of
+// each texture by its weight.
+bool saveBiomeMap(const string& fileName, const TerrainConfig& config, const vector<VertexData>& vertices)
+{
+	ofstream file(fileName, ios::binary);
+
+	if (!file)
+	{
+		return (false);
+	}
+
+	file << "P6\n" << config.gridSize << " " << config.gridSize << "\n255\n";
+
+	vector<unsigned char> row(config.gridSize * 3);
+
+	for (int r = 0; r < config.gridSize; r++)
+	{
+		for (int c = 0; c < config.gridSize; c++)
+		{
+			vec4 weights = vertices[r * config.gridSize + c].colours;
+			vec3 colour = vec3(0.0f);
+			float total = 0.0f;
+
+			for (int t = 0; t < 4; t++)
+			{
+				colour += biomeTextureColours[t] * weights[t];
+				total += weights[t];
+			}
+
+			if (total > 0.0f)
+			{
+				colour /= total;
+			}
+
+			for (int i = 0; i < 3; i++)
+			{
+				row[c * 3 + i] = (unsigned char)(glm::clamp(colour[i], 0.0f, 255.0f) + 0.5f);
+			}
+		}
+
+		file.write((const char*)row.data(), row.size());
+	}
+
+	return ((bool)file);
+}
+
+// Samples the noise the way TerrainNoise did before it worked out the Perlin
+// noise itself - a separate FastNoiseLite call for each height octave, the
+// path and the model noise
+TerrainNoise::Sample getReferenceSample(const FastNoiseLite& terrainNoise, const FastNoiseLite& pathNoise, const FastNoiseLite& modelNoise, float x, float y)
+{
+	TerrainNoise::Sample s;
+
+	s.terrain = 1 * terrainNoise.GetNoise(x, y)
+		+ 0.5 * terrainNoise.GetNoise(2 * x, 2 * y)
+		+ 0.25 * terrainNoise.GetNoise(4 * x, 4 * y);
+
+	s.path = fabs(pathNoise.GetNoise(x, y));
+	s.model = modelNoise.GetNoise(x, y);
+	s.height = (s.terrain / (1 + 0.5 + 0.25)) * 2;
+
+	return (s);
+}
+
+// Best time of each of two ways of doing the same work, and how many of
+// their results differ
+struct Comparison
+{
+	double	referenceMs;
+	double	testMs;
+	int		mismatches;
+};
+
+// Times a reference against the path being tested, running each the given
+// number of times and keeping the best, then counts the results (0 to
+// count - 1) for which differs returns true. Prints both times and the
+// mismatches on one line - callers print anything else about their results.
+template <typename Reference, typename Test, typename Differs>
+Comparison timeCompare(const string& title, int runs, const string& referenceName, Reference reference, const string& testName, Test test,
+	int count, const string& items, Differs differs)
+{
+	Comparison result = { 0.0, 0.0, 0 };
+
+	for (int run = 0; run < runs; run++)
+	{
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+		reference();
+
+		chrono::high_resolution_clock::time_point middle = chrono::high_resolution_clock::now();
+
+		test();
+
+		chrono::high_resolution_clock::time_point end = chrono::high_resolution_clock::now();
+
+		double ms = chrono::duration<double, milli>(middle - start).count();
+		result.referenceMs = run == 0 ? ms : std::min(result.referenceMs, ms);
+
+		ms = chrono::duration<double, milli>(end - middle).count();
+		result.testMs = run == 0 ? ms : std::min(result.testMs, ms);
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		if (differs(i))
+		{
+			result.mismatches++;
+		}
+	}
+
+	cout << "\n" << title << " (best of " << runs << "): " << referenceName << " " << fixed << setprecision(3) << result.referenceMs << " ms, "
+		<< testName << " " << result.testMs << " ms - " << setprecision(2) << result.referenceMs / result.testMs << "x, "
+		<< result.mismatches << " " << items << " differ\n" << setprecision(3);
+
+	return (result);
+}
+
+// Times TerrainNoise against separate FastNoiseLite calls over the whole map
+// (on one thread), and checks that every sample matches exactly
+void compareNoise(const TerrainConfig& config, int runs)
+{
+	FastNoiseLite terrainNoise;
+	terrainNoise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+	terrainNoise.SetFrequency(config.terrainFrequency);
+	terrainNoise.SetSeed(config.getTerrainSeed());
+
+	FastNoiseLite pathNoise;
+	pathNoise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+	pathNoise.SetFrequency(config.pathFrequency);
+	pathNoise.SetSeed(config.getPathSeed());
+
+	FastNoiseLite modelNoise;
+	modelNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+	modelNoise.SetFrequency(config.modelFrequency);
+	modelNoise.SetSeed(config.getModelSeed());
+
+	TerrainNoise noise(config);
+
+	vector<TerrainNoise::Sample> reference(config.getMapSize());
+	vector<TerrainNoise::Sample> fused(config.getMapSize());
+
+	Comparison result = timeCompare("Noise, 1 thread", runs, "separate calls", [&]()
+	{
+		for (int i = 0; i < config.getMapSize(); i++)
+		{
+			reference[i] = getReferenceSample(terrainNoise, pathNoise, modelNoise, (float)(i / config.gridSize), (float)(i % config.gridSize));
+		}
+	}, "TerrainNoise", [&]()
+	{
+		for (int i = 0; i < config.getMapSize(); i++)
+		{
+			fused[i] = noise.getSample((float)(i / config.gridSize), (float)(i % config.gridSize));
+		}
+	}, config.getMapSize(), "samples", [&](int i)
+	{
+		return (memcmp(&reference[i], &fused[i], sizeof(TerrainNoise::Sample)) != 0);
+	});
+
+	cout << "  " << config.getMapSize() / (result.referenceMs * 1000.0) << " -> " << config.getMapSize() / (result.testMs * 1000.0) << " M samples/s\n";
+}
+
+// Times looking up the ground at random positions one at a time (getHeight
+// and getBiome) against HeightField::getSamples, and checks the batched
+// heights and biomes match
+void compareQueries(TerrainGenerator* generator, const TerrainConfig& config, int count, int runs)
+{
+	HeightField field(config, generator);
+
+	vector<float> x(count);
+	vector<float> z(count);
+
+	float size = (config.gridSize - 1) * config.verticeOffset;
+
+	for (int i = 0; i < count; i++)
+	{
+		x[i] = config.getStartPos() + size * (Random::hash(config.worldSeed, Random::MODEL_TYPE, i * 2) / 4294967296.0f);
+		z[i] = config.getStartPos() - size * (Random::hash(config.worldSeed, Random::MODEL_TYPE, i * 2 + 1) / 4294967296.0f);
+	}
+
+	vector<float> singleHeights(count);
+	vector<TerrainGenerator::Biome> singleBiomes(count);
+	vector<float> heights(count);
+	vector<vec3> normals(count);
+	vector<TerrainGenerator::Biome> biomes(count);
+
+	Comparison result = timeCompare("Ground queries, " + to_string(count) + " positions", runs, "one at a time (heights and biomes)", [&]()
+	{
+		for (int i = 0; i < count; i++)
+		{
+			singleHeights[i] = field.getHeight(x[i], z[i]);
+			singleBiomes[i] = field.getBiome(x[i], z[i]);
+		}
+	}, "getSamples (heights, normals and biomes)", [&]()
+	{
+		field.getSamples(x.data(), z.data(), count, heights.data(), normals.data(), biomes.data());
+	}, count, "samples", [&](int i)
+	{
+		return (memcmp(&singleHeights[i], &heights[i], sizeof(float)) != 0 || biomes[i] != singleBiomes[i]);
+	});
+
+	cout << "  " << count / (result.testMs * 1000.0) << " M samples/s batched\n";
+}
+
+// Times labelling the regions with TerrainRegions against a flood fill on one
+// thread - each region filled from its first vertex, row by row, so both
+// number the regions the same way - and checks every vertex's label
+void compareRegions(TerrainGenerator* generator, const TerrainConfig& config, int runs)
+{
+	const int gridSize = config.gridSize;
+
+	TerrainRegions* regions = NULL;
+
+	vector<int> labels(config.getMapSize());
+	vector<int> stack;
+
+	Comparison result = timeCompare("Regions", runs, "flood fill on 1 thread", [&]()
+	{
+		int count = 0;
+
+		std::fill(labels.begin(), labels.end(), -1);
+
+		for (int i = 0; i < config.getMapSize(); i++)
+		{
+			TerrainGenerator::RegionType type = TerrainGenerator::biomeTable[generator->getMapBiome(i)].region;
+
+			if (type == TerrainGenerator::REGION_NONE || labels[i] >= 0)
+			{
+				continue;
+			}
+
+			labels[i] = count;
+			stack.push_back(i);
+
+			while (!stack.empty())
+			{
+				int v = stack.back();
+				stack.pop_back();
+
+				int neighbours[4] = { v % gridSize > 0 ? v - 1 : -1, v % gridSize < gridSize - 1 ? v + 1 : -1, v - gridSize, v + gridSize };
+
+				for (int n = 0; n < 4; n++)
+				{
+					int u = neighbours[n];
+
+					if (u >= 0 && u < config.getMapSize() && labels[u] < 0 && TerrainGenerator::biomeTable[generator->getMapBiome(u)].region == type)
+					{
+						labels[u] = count;
+						stack.push_back(u);
+					}
+				}
+			}
+
+			count++;
+		}
+	}, "TerrainRegions (labelled and measured)", [&]()
+	{
+		delete regions;
+		regions = new TerrainRegions(config, generator->getBiomeMap(), generator->getHeightMap());
+	}, config.getMapSize(), "vertices", [&](int i)
+	{
+		return (regions->getRegion(i) != labels[i]);
+	});
+
+	cout << "  " << regions->getRegionCount(TerrainGenerator::REGION_OASIS) << " oases, " << regions->getRegionCount(TerrainGenerator::REGION_GRASS)
+		<< " grassland patches - " << config.getMapSize() / (result.testMs * 1000.0) << " M vertices/s\n";
+
+	const TerrainGenerator::RegionType types[2] = { TerrainGenerator::REGION_OASIS, TerrainGenerator::REGION_GRASS };
+	const char* names[2] = { "oasis", "grassland patch" };
+
+	for (int t = 0; t < 2; t++)
+	{
+		int largest = regions->getLargestRegion(types[t]);
+
+		if (largest >= 0)
+		{
+			const TerrainRegions::Region& region = regions->getRegions()[largest];
+
+			cout << "  Largest " << names[t] << ": " << region.area << " vertices, centred on (" << region.centroid.x << ", " << region.centroid.y
+				<< "), heights " << region.minBounds.y << " to " << region.maxBounds.y << "\n";
+		}
+	}
+
+	delete regions;
+}
+
+// Times finding the distance from random vertices to every water vertex on
+// the map against TerrainDistance over the whole map, and checks the
+// distances of those vertices match
+void checkWaterDistances(TerrainGenerator* generator, const TerrainConfig& config, int count, int runs)
+{
+	const int gridSize = config.gridSize;
+
+	vector<int> water;
+
+	for (int i = 0; i < config.getMapSize(); i++)
+	{
+		if (generator->getMapBiome(i) == TerrainGenerator::OASIS)
+		{
+			water.push_back(i);
+		}
+	}
+
+	vector<int> checked(count);
+	vector<float> expected(count);
+	vector<unsigned short> distances;
+
+	for (int n = 0; n < count; n++)
+	{
+		checked[n] = Random::range(config.worldSeed, Random::MODEL_TYPE, n, 0, config.getMapSize() - 1);
+	}
+
+	TerrainDistance distance(config);
+
+	timeCompare("Water distances", runs, "every water vertex for " + to_string(count) + " vertices", [&]()
+	{
+		for (int n = 0; n < count; n++)
+		{
+			int row = checked[n] / gridSize;
+			int col = checked[n] % gridSize;
+
+			long long closest = -1;
+
+			for (int w = 0; w < water.size(); w++)
+			{
+				long long rows = water[w] / gridSize - row;
+				long long cols = water[w] % gridSize - col;
+
+				if (closest < 0 || rows * rows + cols * cols < closest)
+				{
+					closest = rows * rows + cols * cols;
+				}
+			}
+
+			expected[n] = closest < 0 ? numeric_limits<float>::infinity() : sqrtf((float)closest) * config.verticeOffset;
+		}
+	}, "TerrainDistance for the map", [&]()
+	{
+		distance.build(generator->getBiomeMap(), (unsigned char)TerrainGenerator::OASIS, &distances);
+	}, count, "vertices", [&](int n)
+	{
+		return (packHalf1x16(expected[n]) != distances[checked[n]]);
+	});
+
+	float furthest = 0.0f;
+
+	for (int n = 0; n < count; n++)
+	{
+		furthest = std::max(furthest, unpackHalf1x16(distances[checked[n]]));
+	}
+
+	cout << "  " << water.size() << " water vertices, furthest checked " << furthest << "\n";
+}
+
+// Vertex cache use of every chunk's triangles
+MeshOptimiser::CacheStats analyseChunks(const TerrainConfig& config, const vector<unsigned short>& indices, const vector<int>& chunkStarts)
+{
+	MeshOptimiser::CacheStats stats = { 0, 0, 0 };
+
+	for (int chunk = 0; chunk + 1 < chunkStarts.size(); chunk++)
+	{
+		stats.add(MeshOptimiser::analyseVertexCache(indices.data() + chunkStarts[chunk], chunkStarts[chunk + 1] - chunkStarts[chunk],
+			config.getDrawChunkVertices()));
+	}
+
+	return (stats);
+}
+
+// The triangles of one chunk, each turned to start at its lowest index (so
+// keeping its winding) and sorted - the same whatever order they are drawn in
+vector<unsigned long long> getChunkTriangles(const vector<unsigned short>& indices, const vector<int>& chunkStarts, int chunk)
+{
+	vector<unsigned long long> triangles;
+
+	for (int t = chunkStarts[chunk]; t < chunkStarts[chunk + 1]; t += 3)
+	{
+		int first = 0;
+
+		for (int v = 1; v < 3; v++)
+		{
+			if (indices[t + v] < indices[t + first])
+			{
+				first = v;
+			}
+		}
+
+		unsigned long long triangle = 0;
+
+		for (int v = 0; v < 3; v++)
+		{
+			triangle = (triangle << 16) | indices[t + (first + v) % 3];
+		}
+
+		triangles.push_back(triangle);
+	}
+
+	sort(triangles.begin(), triangles.end());
+
+	return (triangles);
+}
+
+// Times building the adaptive mesh of every chunk with and without the vertex
+// cache reordering, and checks the reordering keeps the same triangles in
+// every chunk. Then compares the mesh with the full grid - triangles, the
+// area covered (which should be the whole map, once) and how far the
+// triangles are from the heights of the vertices they cover - and the vertex
+// cache use before and after the reordering.
+void checkAdaptiveMesh(TerrainGenerator* generator, const TerrainConfig& config, float maxError, int runs)
+{
+	const int chunks = config.getDrawChunks();
+	const int chunkSide = DRAW_CHUNK_QUADS + 1;
+	const int lastVertex = config.gridSize - 1;
+
+	TerrainRTIN rtin(config, maxError);
+	TerrainRTIN unordered(config, maxError, false);
+
+	vector<unsigned short> unorderedIndices;
+	vector<int> unorderedStarts;
+	vector<unsigned short> indices;
+	vector<int> chunkStarts;
+
+	timeCompare("Adaptive mesh", runs, "unordered", [&]()
+	{
+		unordered.buildMesh(generator, &unorderedIndices, &unorderedStarts);
+	}, "reordered for the vertex cache", [&]()
+	{
+		rtin.buildMesh(generator, &indices, &chunkStarts);
+	}, chunks * chunks, "chunks", [&](int chunk)
+	{
+		return (getChunkTriangles(unorderedIndices, unorderedStarts, chunk) != getChunkTriangles(indices, chunkStarts, chunk));
+	});
+
+	MeshOptimiser::CacheStats before = analyseChunks(config, unorderedIndices, unorderedStarts);
+	MeshOptimiser::CacheStats after = analyseChunks(config, indices, chunkStarts);
+
+	// Twice the area of each triangle, in quads, and the largest error of
+	// any vertex inside one
+	long long doubleArea = 0;
+	float largestError = 0.0f;
+	int badTriangles = 0;
+
+	for (int chunk = 0; chunk < chunks * chunks; chunk++)
+	{
+		int chunkRow = (chunk / chunks) * DRAW_CHUNK_QUADS;
+		int chunkCol = (chunk % chunks) * DRAW_CHUNK_QUADS;
+
+		for (int t = chunkStarts[chunk]; t < chunkStarts[chunk + 1]; t += 3)
+		{
+			int x[3], y[3];
+			float h[3];
+
+			for (int v = 0; v < 3; v++)
+			{
+				x[v] = indices[t + v] % chunkSide;
+				y[v] = indices[t + v] / chunkSide;
+				h[v] = generator->getMapHeight((chunkRow + y[v]) * config.gridSize + chunkCol + x[v]);
+			}
+
+			int cross = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+
+			if (cross >= 0 || std::max(chunkCol + std::max(x[0], std::max(x[1], x[2])), chunkRow + std::max(y[0], std::max(y[1], y[2]))) > lastVertex)
+			{
+				badTriangles++;
+				continue;
+			}
+
+			doubleArea -= cross;
+
+			for (int row = std::min(y[0], std::min(y[1], y[2])); row <= std::max(y[0], std::max(y[1], y[2])); row++)
+			{
+				for (int col = std::min(x[0], std::min(x[1], x[2])); col <= std::max(x[0], std::max(x[1], x[2])); col++)
+				{
+					// Barycentric weights of the vertex, all >= 0 inside
+					float w0 = (float)((x[1] - col) * (y[2] - row) - (y[1] - row) * (x[2] - col)) / cross;
+					float w1 = (float)((x[2] - col) * (y[0] - row) - (y[2] - row) * (x[0] - col)) / cross;
+					float w2 = 1.0f - w0 - w1;
+
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+					{
+						continue;
+					}
+
+					float height = generator->getMapHeight((chunkRow + row) * config.gridSize + chunkCol + col);
+
+					largestError = std::max(largestError, fabsf(w0 * h[0] + w1 * h[1] + w2 * h[2] - height));
+				}
+			}
+		}
+	}
+
+	int triangles = (int)indices.size() / 3;
+
+	cout << "  Error " << maxError << ": " << triangles << " triangles, " << config.getTotalTriangles() << " in the full grid (" << setprecision(1)
+		<< 100.0 * triangles / config.getTotalTriangles() << "%)\n" << setprecision(3);
+	cout << "  Area covered " << doubleArea / 2 << " of " << (long long)config.getRowChunks() * config.getRowChunks() << " quads, "
+		<< badTriangles << " bad triangles, largest vertex error " << largestError << "\n";
+	cout << "  Vertex cache: ACMR " << before.getACMR() << " -> " << after.getACMR() << ", ATVR " << before.getATVR() << " -> " << after.getATVR() << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	TerrainConfig config;
+	config.worldSeed = (unsigned int)time((time_t*)NULL);
+
+	int runs = 1;
+	string heightMapFile;
+	string biomeMapFile;
+	bool compare = false;
+	int queries = 0;
+	bool labelRegions = false;
+	int waterChecks = 0;
+	float meshError = 0.0f;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+
+		if (arg == "--size" && i + 1 < argc)
+		{
+			config.gridSize = atoi(argv[++i]);
+		}
+		else if (arg == "--seed" && i + 1 < argc)
+		{
+			config.worldSeed = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}
+		else if (arg == "--erosion" && i + 1 < argc)
+		{
+			config.erosionIterations = atoi(argv[++i]);
+		}
+		else if (arg == "--erosion-seed" && i + 1 < argc)
+		{
+			config.erosionSeed = (unsigned int)strtoul(argv[++i], NULL, 10);
+		}
+		else if (arg == "--runs" && i + 1 < argc)
+		{
+			runs = std::max(atoi(argv[++i]), 1);
+		}
+		else if (arg == "--heightmap" && i + 1 < argc)
+		{
+			heightMapFile = argv[++i];
+		}
+		else if (arg == "--biomes" && i + 1 < argc)
+		{
+			biomeMapFile = argv[++i];
+		}
+		else if (arg == "--compare-noise")
+		{
+			compare = true;
+		}
+		else if (arg == "--queries" && i + 1 < argc)
+		{
+			queries = atoi(argv[++i]);
+		}
+		else if (arg == "--regions")
+		{
+			labelRegions = true;
+		}
+		else if (arg == "--check-water" && i + 1 < argc)
+		{
+			waterChecks = atoi(argv[++i]);
+		}
+		else if (arg == "--adaptive" && i + 1 < argc)
+		{
+			meshError = (float)atof(argv[++i]);
+		}
+		else
+		{
+			cout << "Usage: TerrainGen [--size <n>] [--seed <n>] [--erosion <n>] [--erosion-seed <n>]\n"
+				<< "                  [--runs <n>] [--heightmap <file.pgm>] [--biomes <file.ppm>] [--compare-noise]\n"
+				<< "                  [--queries <n>] [--regions] [--check-water <n>] [--adaptive <error>]\n";
+			return -1;
+		}
+	}
+
+	if (config.gridSize < 2)
+	{
+		cout << "ERROR: Map size must be at least 2\n";
+		return -1;
+	}
+
+	cout << "World seed: " << config.worldSeed << ", " << config.gridSize << "x" << config.gridSize << " ("
+		<< config.getMapSize() << " vertices), " << ThreadPool::getShared()->getThreadCount() << " threads\n";
+
+	// Best and total time of each stage over all runs
+	vector<TerrainGenerator::StageTime> bestTimes;
+	vector<double> totalTimes;
+
+	TerrainGenerator* generator = NULL;
+
+	for (int run = 0; run < runs; run++)
+	{
+		delete generator;
+
+		generator = new TerrainGenerator(config);
+		generator->generate();
+
+		const vector<TerrainGenerator::StageTime>& times = generator->getStageTimes();
+
+		if (run == 0)
+		{
+			bestTimes = times;
+			totalTimes.assign(times.size(), 0.0);
+		}
+
+		for (int s = 0; s < times.size(); s++)
+		{
+			bestTimes[s].ms = std::min(bestTimes[s].ms, times[s].ms);
+			totalTimes[s] += times[s].ms;
+		}
+	}
+
+	// Per stage timings, with throughput in vertices (map cells) per second
+	double bestTotal = 0.0;
+	double meanTotal = 0.0;
+
+	cout << "\n" << left << setw(16) << "Stage" << right << setw(12) << "Best ms" << setw(12) << "Mean ms" << setw(16) << "M vertices/s\n";
+
+	for (int s = 0; s < bestTimes.size(); s++)
+	{
+		double mean = totalTimes[s] / runs;
+
+		bestTotal += bestTimes[s].ms;
+		meanTotal += mean;
+
+		cout << left << setw(16) << bestTimes[s].name << right << fixed << setprecision(3) << setw(12) << bestTimes[s].ms << setw(12) << mean
+			<< setw(15) << config.getMapSize() / (bestTimes[s].ms * 1000.0) << "\n";
+	}
+
+	cout << left << setw(16) << "Total" << right << setw(12) << bestTotal << setw(12) << meanTotal
+		<< setw(15) << config.getMapSize() / (bestTotal * 1000.0) << "\n";
+
+	vector<vec3> grassPositions;
+	vector<vec3> oasisPositions;
+
+	generator->getGrassModelPositions(&grassPositions);
+	generator->getOasisModelPositions(&oasisPositions);
+
+	cout << "\n" << grassPositions.size() << " grass models, " << oasisPositions.size() << " oasis models\n";
+
+	if (!heightMapFile.empty())
+	{
+		cout << (saveHeightMap(heightMapFile, config, generator->getVertices()) ? "Saved height map to " : "[!] Could not save height map to ")
+			<< heightMapFile << "\n";
+	}
+
+	if (!biomeMapFile.empty())
+	{
+		cout << (saveBiomeMap(biomeMapFile, config, generator->getVertices()) ? "Saved biome map to " : "[!] Could not save biome map to ")
+			<< biomeMapFile << "\n";
+	}
+
+	if (compare)
+	{
+		compareNoise(config, runs);
+	}
+
+	if (queries > 0)
+	{
+		compareQueries(generator, config, queries, runs);
+	}
+
+	if (labelRegions)
+	{
+		compareRegions(generator, config, runs);
+	}
+
+	if (waterChecks > 0)
+	{
+		checkWaterDistances(generator, config, waterChecks, runs);
+	}
+
+	if (meshError > 0.0f)
+	{
+		checkAdaptiveMesh(generator, config, meshError, runs);
+	}
+
+	delete generator;
+
+	return 0;
+}